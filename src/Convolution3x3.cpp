@@ -0,0 +1,175 @@
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+
+#include "common.h"
+#include "rg_functions_c.h"
+
+static ConvPlaneProcessor* get_c_convolution(int bits_per_pixel) {
+	if (bits_per_pixel == 8)
+		return process_plane_conv<uint8_t, float, conv_horizontal_c<uint8_t>, conv_vertical_c<uint8_t>>;
+	if (bits_per_pixel > 8 && bits_per_pixel <= 16)
+		return process_plane_conv<uint16_t, float, conv_horizontal_c<uint16_t>, conv_vertical_c<uint16_t>>;
+	if (bits_per_pixel == 32)
+		return process_plane_conv<float, float, conv_horizontal_c<float>, conv_vertical_c<float>>;
+	return nullptr;
+}
+
+// same walk down the instruction sets as RemoveGrain
+static ConvPlaneProcessor* select_convolution(int opt, int bits_per_pixel) {
+	ConvPlaneProcessor* function = nullptr;
+	if (opt >= 5)
+		function = avx512_convolution(bits_per_pixel);
+	if (!function && opt >= 4)
+		function = avx2_convolution(bits_per_pixel);
+	if (!function && opt >= 3)
+		function = sse4_convolution(bits_per_pixel);
+	if (!function && opt >= 2)
+		function = sse2_convolution(bits_per_pixel);
+	if (!function)
+		function = get_c_convolution(bits_per_pixel);
+	return function;
+}
+
+// Splits the kernel into separable terms. Rows that are multiples of the same row share one term
+// and differ only in its column taps, so a separable kernel like 1 2 1 / 2 4 2 / 1 2 1 is one term.
+static void split_kernel(const int weights[9], ConvParams& params) {
+	params.terms = 0;
+	for (int row = 0; row < 3; ++row) {
+		const int* w = weights + row * 3;
+		int scale = std::gcd(std::gcd(w[0], w[1]), w[2]);
+		if (!scale)
+			continue;
+		// the first nonzero tap of a term row is positive
+		if ((w[0] ? w[0] : w[1] ? w[1] : w[2]) < 0)
+			scale = -scale;
+
+		int t = 0;
+		while (t < params.terms &&
+			!(params.horizontal[t][0] == w[0] / scale && params.horizontal[t][1] == w[1] / scale && params.horizontal[t][2] == w[2] / scale))
+			++t;
+		if (t == params.terms) {
+			for (int i = 0; i < 3; ++i)
+				params.horizontal[t][i] = static_cast<float>(w[i] / scale);
+			params.terms++;
+		}
+		params.vertical[t][row] = static_cast<float>(scale);
+	}
+}
+
+static const VSFrame* VS_CC convolution3x3GetFrame(int n, int activationReason, void* instanceData, void** frameData, VSFrameContext* frameCtx, VSCore* core, const VSAPI* vsapi) {
+	auto d{ static_cast<Convolution3x3Data*>(instanceData) };
+
+	if (activationReason == arInitial) {
+		vsapi->requestFrameFilter(n, d->node, frameCtx);
+	}
+	else if (activationReason == arAllFramesReady) {
+		const VSFrame* src = vsapi->getFrameFilter(n, d->node, frameCtx);
+		const VSVideoFormat* fi = vsapi->getVideoFrameFormat(src);
+		int srch = vsapi->getFrameHeight(src, 0);
+		int srcw = vsapi->getFrameWidth(src, 0);
+		VSFrame* dst = vsapi->newVideoFrame(fi, srcw, srch, src, core);
+
+		for (int plane{ 0 }; plane < d->vi->format.numPlanes; plane++) {
+			const uint8_t* srcp = vsapi->getReadPtr(src, plane);
+			const ptrdiff_t src_pitch = vsapi->getStride(src, plane);
+			uint8_t* dstp = vsapi->getWritePtr(dst, plane);
+			ptrdiff_t dst_pitch = vsapi->getStride(dst, plane);
+			const int width{ vsapi->getFrameWidth(src, plane) };
+			const int height{ vsapi->getFrameHeight(src, plane) };
+
+			d->function(srcp, dstp, width, height, src_pitch, dst_pitch, d->params);
+		}
+
+		vsapi->freeFrame(src);
+		return dst;
+	}
+	return nullptr;
+}
+
+static void VS_CC convolution3x3Free(void* instanceData, VSCore* core, const VSAPI* vsapi) {
+	auto d{ static_cast<Convolution3x3Data*>(instanceData) };
+	vsapi->freeNode(d->node);
+	delete d;
+}
+
+void VS_CC convolution3x3Create(const VSMap* in, VSMap* out, void* userData, VSCore* core, const VSAPI* vsapi) {
+	auto d{ std::make_unique<Convolution3x3Data>() };
+	int err = 0;
+
+	d->node = vsapi->mapGetNode(in, "clip", 0, nullptr);
+	d->vi = vsapi->getVideoInfo(d->node);
+
+	const VSVideoFormat& format = d->vi->format;
+	if (!vsh::isConstantVideoFormat(d->vi) ||
+		(format.sampleType == stInteger && (format.bitsPerSample < 8 || format.bitsPerSample > 16)) ||
+		(format.sampleType == stFloat && format.bitsPerSample != 32)) {
+		vsapi->mapSetError(out, "Convolution3x3: only constant format 8-16 bit integer and 32 bit float input supported");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	if (vsapi->mapNumElements(in, "weights") != 9) {
+		vsapi->mapSetError(out, "Convolution3x3: weights must contain 9 values");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const int64_t* weights64 = vsapi->mapGetIntArray(in, "weights", nullptr);
+	int weights[9];
+	int weight_sum = 0;
+	bool all_zero = true;
+	for (int i = 0; i < 9; ++i) {
+		if (weights64[i] < -1023 || weights64[i] > 1023) {
+			vsapi->mapSetError(out, "Convolution3x3: weights must be between -1023 and 1023");
+			vsapi->freeNode(d->node);
+			return;
+		}
+		weights[i] = static_cast<int>(weights64[i]);
+		weight_sum += weights[i];
+		all_zero = all_zero && !weights[i];
+	}
+
+	if (all_zero) {
+		vsapi->mapSetError(out, "Convolution3x3: weights must not all be 0");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	d->params.divisor = static_cast<float>(vsapi->mapGetFloat(in, "divisor", 0, &err));
+	if (err)
+		d->params.divisor = weight_sum ? static_cast<float>(weight_sum) : 1.0f;
+
+	if (d->params.divisor == 0.0f || !std::isfinite(d->params.divisor)) {
+		vsapi->mapSetError(out, "Convolution3x3: divisor must be a finite value other than 0");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	split_kernel(weights, d->params);
+	if (format.sampleType == stInteger)
+		d->params.pixel_max = static_cast<float>((1 << format.bitsPerSample) - 1);
+
+	d->opt = vsapi->mapGetIntSaturated(in, "opt", 0, &err);
+	if (err)
+		d->opt = 0;
+
+	if (d->opt < 0 || d->opt > 5) {
+		vsapi->mapSetError(out, "Convolution3x3: opt must be between 0 and 5");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const int cpu_opt = get_cpu_opt();
+	if (d->opt > cpu_opt) {
+		vsapi->mapSetError(out, "Convolution3x3: opt is not supported by this CPU");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	d->function = select_convolution(d->opt ? d->opt : cpu_opt, format.bitsPerSample);
+
+	VSFilterDependency deps[] = { {d->node, rpStrictSpatial} };
+	vsapi->createVideoFilter(out, "Convolution3x3", d->vi, convolution3x3GetFrame, convolution3x3Free, fmParallel, deps, 1, d.get(), core);
+	d.release();
+}
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+#include "common.h"
+#include "rg_functions_c.h"
+
+static CustomPlaneProcessor* get_c_custom(int bits_per_pixel) {
+	if (bits_per_pixel == 8)
+		return process_plane_custom_c<uint8_t>;
+	if (bits_per_pixel > 8 && bits_per_pixel <= 16)
+		return process_plane_custom_c<uint16_t>;
+	if (bits_per_pixel == 32)
+		return process_plane_custom_c<float>;
+	return nullptr;
+}
+
+// same walk down the instruction sets as RemoveGrain
+static CustomPlaneProcessor* select_custom(int opt, int bits_per_pixel) {
+	CustomPlaneProcessor* function = nullptr;
+	if (opt >= 5)
+		function = avx512_custom(bits_per_pixel);
+	if (!function && opt >= 4)
+		function = avx2_custom(bits_per_pixel);
+	if (!function && opt >= 3)
+		function = sse4_custom(bits_per_pixel);
+	if (!function && opt >= 2)
+		function = sse2_custom(bits_per_pixel);
+	if (!function)
+		function = get_c_custom(bits_per_pixel);
+	return function;
+}
+
+// Compiles an expression like clip(c, min(a1, a8), max(a1, a8)) into a CustomProgram.
+//   expr := name | number | function '(' expr { ',' expr } ')'
+// Names are a1-a8 and c, numbers are pixel values. min and max take two or more arguments,
+// clip(value, minimum, maximum) three, avg, absdiff, adds and subs two.
+// Identical operations are compiled once, min, max, avg, absdiff and adds in either argument order.
+class CustomCompiler final {
+public:
+	CustomCompiler(const std::string& expr, bool integer_format, int max_value) : text(expr), integer(integer_format), pixel_max(max_value) {}
+
+	// empty on success
+	std::string compile(CustomProgram& program) {
+		out = &program;
+		program = CustomProgram();
+		program.pixel_max = pixel_max;
+		const int result = parse_expr();
+		skip_space();
+		if (result >= 0 && pos != text.size())
+			fail("unexpected '" + text.substr(pos, 1) + "'");
+		if (!error.empty())
+			return error + " at position " + std::to_string(pos + 1);
+
+		// constants are placed right after the square, instructions were numbered from the end of the register file
+		const int first = CustomProgram::square_registers + program.num_constants;
+		auto remap = [&](int reg) { return reg >= instr_base ? reg - instr_base + first : reg; };
+		for (int i = 0; i < program.num_instructions; ++i) {
+			CustomInstr& instr = program.code[i];
+			instr.dst = static_cast<uint8_t>(remap(instr.dst));
+			for (auto& src : instr.src)
+				src = static_cast<uint8_t>(remap(src));
+		}
+		program.result = remap(result);
+		return error;
+	}
+
+private:
+	static constexpr int instr_base = CustomProgram::max_registers;
+	// bounds the recursion of parse_expr
+	static constexpr int max_depth = 64;
+
+	const std::string text;
+	const bool integer;
+	const int pixel_max;
+	size_t pos = 0;
+	int depth = 0;
+	std::string error;
+	CustomProgram* out = nullptr;
+
+	int fail(const std::string& message) {
+		if (error.empty())
+			error = message;
+		return -1;
+	}
+
+	void skip_space() {
+		while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+			++pos;
+	}
+
+	bool accept(char ch) {
+		skip_space();
+		if (pos < text.size() && text[pos] == ch) {
+			++pos;
+			return true;
+		}
+		return false;
+	}
+
+	int constant(double value) {
+		if (!std::isfinite(value))
+			return fail("constants must be finite");
+		if (integer && (value != std::floor(value) || value < 0 || value > pixel_max))
+			return fail("constants must be integers between 0 and " + std::to_string(pixel_max));
+		const float v = static_cast<float>(value);
+		for (int i = 0; i < out->num_constants; ++i)
+			if (out->constants[i] == v)
+				return CustomProgram::square_registers + i;
+		if (CustomProgram::square_registers + out->num_constants + out->num_instructions >= CustomProgram::max_registers)
+			return fail("expression is too long");
+		out->constants[out->num_constants] = v;
+		return CustomProgram::square_registers + out->num_constants++;
+	}
+
+	int emit(CustomOp op, int a, int b, int c = 0) {
+		if (a < 0 || b < 0 || c < 0)
+			return -1;
+		if (op != CustomOp::clip && op != CustomOp::subs && a > b)
+			std::swap(a, b);
+		for (int i = 0; i < out->num_instructions; ++i) {
+			const CustomInstr& instr = out->code[i];
+			if (instr.op == op && instr.src[0] == a && instr.src[1] == b && instr.src[2] == c)
+				return instr.dst;
+		}
+		if (CustomProgram::square_registers + out->num_constants + out->num_instructions >= CustomProgram::max_registers)
+			return fail("expression is too long");
+		CustomInstr& instr = out->code[out->num_instructions];
+		instr.op = op;
+		instr.dst = static_cast<uint8_t>(instr_base + out->num_instructions++);
+		instr.src[0] = static_cast<uint8_t>(a);
+		instr.src[1] = static_cast<uint8_t>(b);
+		instr.src[2] = static_cast<uint8_t>(c);
+		return instr.dst;
+	}
+
+	int parse_expr() {
+		skip_space();
+		if (pos == text.size())
+			return fail("expression expected");
+
+		const char* start = text.c_str() + pos;
+		if (std::isdigit(static_cast<unsigned char>(*start)) || *start == '.' || *start == '-') {
+			char* end = nullptr;
+			const double value = std::strtod(start, &end);
+			if (end == start)
+				return fail("number expected");
+			pos += end - start;
+			return constant(value);
+		}
+
+		const size_t begin = pos;
+		while (pos < text.size() && std::isalnum(static_cast<unsigned char>(text[pos])))
+			++pos;
+		const std::string name = text.substr(begin, pos - begin);
+		if (name.empty())
+			return fail("unexpected '" + text.substr(pos, 1) + "'");
+
+		static const char* const square[] = { "a1", "a2", "a3", "a4", "c", "a5", "a6", "a7", "a8" };
+		for (int i = 0; i < CustomProgram::square_registers; ++i)
+			if (name == square[i])
+				return i;
+
+		static const struct { const char* name; CustomOp op; int args; } functions[] = {
+			{ "min", CustomOp::min, -2 }, // -2: two or more
+			{ "max", CustomOp::max, -2 },
+			{ "clip", CustomOp::clip, 3 },
+			{ "avg", CustomOp::avg, 2 },
+			{ "absdiff", CustomOp::absdiff, 2 },
+			{ "adds", CustomOp::adds, 2 },
+			{ "subs", CustomOp::subs, 2 },
+		};
+		for (const auto& f : functions) {
+			if (name != f.name)
+				continue;
+			if (!accept('('))
+				return fail("'(' expected after " + name);
+			if (depth == max_depth)
+				return fail("expression is nested too deeply");
+			++depth;
+			int args[3];
+			int count = 0;
+			int result = -1;
+			do {
+				const int arg = parse_expr();
+				if (arg < 0)
+					return -1;
+				if (f.args < 0)
+					result = count ? emit(f.op, result, arg) : arg;
+				else if (count < f.args)
+					args[count] = arg;
+				++count;
+			} while (accept(','));
+			--depth;
+			if (!accept(')'))
+				return fail("')' expected");
+			if (f.args < 0 ? count < -f.args : count != f.args)
+				return fail(name + " takes " + (f.args < 0 ? "at least " + std::to_string(-f.args) : std::to_string(f.args)) + " arguments");
+			if (f.args < 0)
+				return result;
+			return emit(f.op, args[0], args[1], f.args == 3 ? args[2] : 0);
+		}
+		return fail("unknown name '" + name + "'");
+	}
+};
+
+static const VSFrame* VS_CC customGetFrame(int n, int activationReason, void* instanceData, void** frameData, VSFrameContext* frameCtx, VSCore* core, const VSAPI* vsapi) {
+	auto d{ static_cast<CustomData*>(instanceData) };
+
+	if (activationReason == arInitial) {
+		vsapi->requestFrameFilter(n, d->node, frameCtx);
+	}
+	else if (activationReason == arAllFramesReady) {
+		const VSFrame* src = vsapi->getFrameFilter(n, d->node, frameCtx);
+		const VSVideoFormat* fi = vsapi->getVideoFrameFormat(src);
+		int srch = vsapi->getFrameHeight(src, 0);
+		int srcw = vsapi->getFrameWidth(src, 0);
+		VSFrame* dst = vsapi->newVideoFrame(fi, srcw, srch, src, core);
+
+		for (int plane{ 0 }; plane < d->vi->format.numPlanes; plane++) {
+			const uint8_t* srcp = vsapi->getReadPtr(src, plane);
+			const ptrdiff_t src_pitch = vsapi->getStride(src, plane);
+			uint8_t* dstp = vsapi->getWritePtr(dst, plane);
+			ptrdiff_t dst_pitch = vsapi->getStride(dst, plane);
+			const int width{ vsapi->getFrameWidth(src, plane) };
+			const int height{ vsapi->getFrameHeight(src, plane) };
+
+			d->function(srcp, dstp, width, height, src_pitch, dst_pitch, d->program);
+		}
+
+		vsapi->freeFrame(src);
+		return dst;
+	}
+	return nullptr;
+}
+
+static void VS_CC customFree(void* instanceData, VSCore* core, const VSAPI* vsapi) {
+	auto d{ static_cast<CustomData*>(instanceData) };
+	vsapi->freeNode(d->node);
+	delete d;
+}
+
+void VS_CC customCreate(const VSMap* in, VSMap* out, void* userData, VSCore* core, const VSAPI* vsapi) {
+	auto d{ std::make_unique<CustomData>() };
+	int err = 0;
+
+	d->node = vsapi->mapGetNode(in, "clip", 0, nullptr);
+	d->vi = vsapi->getVideoInfo(d->node);
+
+	const VSVideoFormat& format = d->vi->format;
+	if (!vsh::isConstantVideoFormat(d->vi) ||
+		(format.sampleType == stInteger && (format.bitsPerSample < 8 || format.bitsPerSample > 16)) ||
+		(format.sampleType == stFloat && format.bitsPerSample != 32)) {
+		vsapi->mapSetError(out, "Custom: only constant format 8-16 bit integer and 32 bit float input supported");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const bool integer = format.sampleType == stInteger;
+	const std::string expr(vsapi->mapGetData(in, "expr", 0, nullptr), vsapi->mapGetDataSize(in, "expr", 0, nullptr));
+	const std::string error = CustomCompiler(expr, integer, integer ? (1 << format.bitsPerSample) - 1 : 0).compile(d->program);
+	if (!error.empty()) {
+		vsapi->mapSetError(out, ("Custom: " + error).c_str());
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	d->opt = vsapi->mapGetIntSaturated(in, "opt", 0, &err);
+	if (err)
+		d->opt = 0;
+
+	if (d->opt < 0 || d->opt > 5) {
+		vsapi->mapSetError(out, "Custom: opt must be between 0 and 5");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const int cpu_opt = get_cpu_opt();
+	if (d->opt > cpu_opt) {
+		vsapi->mapSetError(out, "Custom: opt is not supported by this CPU");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	d->function = select_custom(d->opt ? d->opt : cpu_opt, format.bitsPerSample);
+
+	VSFilterDependency deps[] = { {d->node, rpStrictSpatial} };
+	vsapi->createVideoFilter(out, "Custom", d->vi, customGetFrame, customFree, fmParallel, deps, 1, d.get(), core);
+	d.release();
+}
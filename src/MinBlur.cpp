@@ -0,0 +1,147 @@
+#include "common.h"
+#include "rg_functions_c.h"
+
+static PlaneProcessor* get_c_minblur(int bits_per_pixel) {
+	if (bits_per_pixel == 8)
+		return process_plane_minblur_c<uint8_t>;
+	if (bits_per_pixel > 8 && bits_per_pixel <= 16)
+		return process_plane_minblur_c<uint16_t>;
+	if (bits_per_pixel == 32)
+		return process_plane_minblur_c<float>;
+	return nullptr;
+}
+
+// same walk down the instruction sets as RemoveGrain, fp16 only has AVX2 and AVX-512 versions
+static PlaneProcessor* select_minblur(int opt, int bits_per_pixel, bool half) {
+	if (half)
+		return opt >= 5 ? avx512_half_minblur() : opt >= 4 ? avx2_half_minblur() : nullptr;
+
+	PlaneProcessor* function = nullptr;
+	if (opt >= 5)
+		function = avx512_minblur(bits_per_pixel);
+	if (!function && opt >= 4)
+		function = avx2_minblur(bits_per_pixel);
+	if (!function && opt >= 3)
+		function = sse4_minblur(bits_per_pixel);
+	if (!function && opt >= 2)
+		function = sse2_minblur(bits_per_pixel);
+	if (!function)
+		function = get_c_minblur(bits_per_pixel);
+	return function;
+}
+
+static const VSFrame* VS_CC minBlurGetFrame(int n, int activationReason, void* instanceData, void** frameData, VSFrameContext* frameCtx, VSCore* core, const VSAPI* vsapi) {
+	auto d{ static_cast<MinBlurData*>(instanceData) };
+
+	if (activationReason == arInitial) {
+		vsapi->requestFrameFilter(n, d->node, frameCtx);
+	}
+	else if (activationReason == arAllFramesReady) {
+		const VSFrame* src = vsapi->getFrameFilter(n, d->node, frameCtx);
+		const VSVideoFormat* fi = vsapi->getVideoFrameFormat(src);
+		int srch = vsapi->getFrameHeight(src, 0);
+		int srcw = vsapi->getFrameWidth(src, 0);
+		VSFrame* dst = vsapi->newVideoFrame(fi, srcw, srch, src, core);
+
+		for (int plane{ 0 }; plane < d->vi->format.numPlanes; plane++) {
+			const uint8_t* srcp = vsapi->getReadPtr(src, plane);
+			const ptrdiff_t src_pitch = vsapi->getStride(src, plane);
+			uint8_t* dstp = vsapi->getWritePtr(dst, plane);
+			ptrdiff_t dst_pitch = vsapi->getStride(dst, plane);
+			const int width{ vsapi->getFrameWidth(src, plane) };
+			const int height{ vsapi->getFrameHeight(src, plane) };
+
+			if (d->process[plane])
+				d->function(srcp, dstp, width, height, src_pitch, dst_pitch, d->pixel_max);
+			else
+				vsh::bitblt(dstp, dst_pitch, srcp, src_pitch, width * fi->bytesPerSample, height);
+		}
+
+		vsapi->freeFrame(src);
+		return dst;
+	}
+	return nullptr;
+}
+
+static void VS_CC minBlurFree(void* instanceData, VSCore* core, const VSAPI* vsapi) {
+	auto d{ static_cast<MinBlurData*>(instanceData) };
+	vsapi->freeNode(d->node);
+	delete d;
+}
+
+// MinBlur of havsfunc for r=1 in one pass: RemoveGrain(11), RemoveGrain(4) and the Expr picking
+// the smaller deviation are computed together from one load of the 3x3 square per pixel.
+// The edge rows and columns are copied like RemoveGrain does. Current havsfunc blurs with
+// std.Convolution and std.Median, which mirror the edges, so the results differ there. r=2 and 3
+// are not implemented.
+void VS_CC minBlurCreate(const VSMap* in, VSMap* out, void* userData, VSCore* core, const VSAPI* vsapi) {
+	auto d{ std::make_unique<MinBlurData>() };
+	int err = 0;
+
+	d->node = vsapi->mapGetNode(in, "clip", 0, nullptr);
+	d->vi = vsapi->getVideoInfo(d->node);
+
+	const VSVideoFormat& format = d->vi->format;
+	if (!vsh::isConstantVideoFormat(d->vi) ||
+		(format.sampleType == stInteger && (format.bitsPerSample < 8 || format.bitsPerSample > 16)) ||
+		(format.sampleType == stFloat && format.bitsPerSample != 16 && format.bitsPerSample != 32)) {
+		vsapi->mapSetError(out, "MinBlur: only constant format 8-16 bit integer and 16, 32 bit float input supported");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const int r = vsapi->mapGetIntSaturated(in, "r", 0, &err);
+	if (!err && r != 1) {
+		vsapi->mapSetError(out, "MinBlur: only r=1 is supported");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const int num_planes = vsapi->mapNumElements(in, "planes");
+	for (int plane = 0; plane < 3; plane++)
+		d->process[plane] = num_planes <= 0;
+	for (int i = 0; i < num_planes; i++) {
+		const int plane = vsapi->mapGetIntSaturated(in, "planes", i, nullptr);
+		if (plane < 0 || plane >= format.numPlanes) {
+			vsapi->mapSetError(out, "MinBlur: plane index out of range");
+			vsapi->freeNode(d->node);
+			return;
+		}
+		if (d->process[plane]) {
+			vsapi->mapSetError(out, "MinBlur: plane specified twice");
+			vsapi->freeNode(d->node);
+			return;
+		}
+		d->process[plane] = true;
+	}
+
+	d->opt = vsapi->mapGetIntSaturated(in, "opt", 0, &err);
+	if (err)
+		d->opt = 0;
+
+	if (d->opt < 0 || d->opt > 5) {
+		vsapi->mapSetError(out, "MinBlur: opt must be between 0 and 5");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const int cpu_opt = get_cpu_opt();
+	if (d->opt > cpu_opt) {
+		vsapi->mapSetError(out, "MinBlur: opt is not supported by this CPU");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const bool half = format.sampleType == stFloat && format.bitsPerSample == 16;
+	d->pixel_max = format.sampleType == stInteger ? (1 << format.bitsPerSample) - 1 : 0;
+	d->function = select_minblur(d->opt ? d->opt : cpu_opt, format.bitsPerSample, half);
+	if (!d->function) {
+		vsapi->mapSetError(out, "MinBlur: 16 bit float input needs AVX2 (F16C), opt must be 0, 4 or 5");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	VSFilterDependency deps[] = { {d->node, rpStrictSpatial} };
+	vsapi->createVideoFilter(out, "MinBlur", d->vi, minBlurGetFrame, minBlurFree, fmParallel, deps, 1, d.get(), core);
+	d.release();
+}
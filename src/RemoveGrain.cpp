@@ -1,8 +1,10 @@
+#include <string>
+
 #include "common.h"
 #include "rg_functions_c.h"
 
-template<typename pixel_t, CModeProcessor<pixel_t> processor>
-static void process_plane_c(const uint8_t* pSrc8, uint8_t* pDst8, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch) {
+template<typename pixel_t, auto processor>
+static void process_plane_c(const uint8_t* pSrc8, uint8_t* pDst8, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max) {
 	vsh::bitblt(pDst8, dstPitch, pSrc8, srcPitch, width * sizeof(pixel_t), 1);
 
 	pixel_t* pDst = reinterpret_cast<pixel_t*>(pDst8);
@@ -17,7 +19,7 @@ static void process_plane_c(const uint8_t* pSrc8, uint8_t* pDst8, int width, int
 	for (int y = 1; y < height - 1; ++y) {
 		pDst[0] = pSrc[0];
 		for (int x = 1; x < width - 1; x += 1) {
-			pixel_t result = processor((uint8_t*)(pSrc + x), srcPitchOrig);
+			pixel_t result = call_processor<processor>((uint8_t*)(pSrc + x), srcPitchOrig, pixel_max);
 			pDst[x] = result;
 		}
 		pDst[width - 1] = pSrc[width - 1];
@@ -29,8 +31,66 @@ static void process_plane_c(const uint8_t* pSrc8, uint8_t* pDst8, int width, int
 	vsh::bitblt((uint8_t*)pDst, dstPitch * sizeof(pixel_t), (uint8_t*)pSrc, srcPitch * sizeof(pixel_t), width * sizeof(pixel_t), 1);
 }
 
-template<typename pixel_t, CModeProcessor<pixel_t> processor>
-static void process_halfplane_c(const uint8_t* pSrc8, uint8_t* pDst8, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch) {
+// Modes 1-4 through the rank engine. Sorted column triples slide along the row,
+// so every column is loaded and sorted once instead of once per neighbouring pixel.
+template<typename pixel_t, int rank>
+static void process_plane_rank_c(const uint8_t* pSrc8, uint8_t* pDst8, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int) {
+	vsh::bitblt(pDst8, dstPitch, pSrc8, srcPitch, width * sizeof(pixel_t), 1);
+
+	pixel_t* pDst = reinterpret_cast<pixel_t*>(pDst8);
+	const pixel_t* pSrc = reinterpret_cast<const pixel_t*>(pSrc8);
+
+	dstPitch /= sizeof(pixel_t);
+	srcPitch /= sizeof(pixel_t);
+
+	pSrc += srcPitch;
+	pDst += dstPitch;
+	for (int y = 1; y < height - 1; ++y) {
+		const pixel_t* pAbove = pSrc - srcPitch;
+		const pixel_t* pBelow = pSrc + srcPitch;
+
+		pDst[0] = pSrc[0];
+		if (width > 2) {
+			pixel_t l0 = pAbove[0], l1 = pSrc[0], l2 = pBelow[0];
+			sort3_c(l0, l1, l2);
+			pixel_t top = pAbove[1], bottom = pBelow[1];
+			pixel_t m0 = top, m1 = pSrc[1], m2 = bottom;
+			sort3_c(m0, m1, m2);
+
+			for (int x = 1; x < width - 1; x += 1) {
+				const pixel_t next_top = pAbove[x + 1];
+				const pixel_t next_bottom = pBelow[x + 1];
+				pixel_t r0 = next_top, r1 = pSrc[x + 1], r2 = next_bottom;
+				sort3_c(r0, r1, r2);
+
+				pixel_t lo, hi;
+				rank_select_c<rank>(l0, l1, l2, top, bottom, r0, r1, r2, lo, hi);
+				pDst[x] = std::max(std::min(pSrc[x], hi), lo);
+
+				l0 = m0; l1 = m1; l2 = m2;
+				m0 = r0; m1 = r1; m2 = r2;
+				top = next_top; bottom = next_bottom;
+			}
+		}
+		pDst[width - 1] = pSrc[width - 1];
+
+		pSrc += srcPitch;
+		pDst += dstPitch;
+	}
+
+	vsh::bitblt((uint8_t*)pDst, dstPitch * sizeof(pixel_t), (uint8_t*)pSrc, srcPitch * sizeof(pixel_t), width * sizeof(pixel_t), 1);
+}
+
+// Modes 11, 12 and 20 through the running-sum engine, see process_plane_conv.
+template<typename pixel_t, int mode>
+static void process_plane_sep_c(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int) {
+	using acc_t = std::conditional_t<std::is_floating_point_v<pixel_t>, float, int>;
+	process_plane_conv<pixel_t, acc_t, sep_horizontal_c<pixel_t, acc_t, mode>, sep_vertical_c<pixel_t, acc_t, mode>>(
+		pSrc, pDst, width, height, srcPitch, dstPitch, ConvParams());
+}
+
+template<typename pixel_t, auto processor>
+static void process_halfplane_c(const uint8_t* pSrc8, uint8_t* pDst8, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max) {
 	pixel_t* pDst = reinterpret_cast<pixel_t*>(pDst8);
 	const pixel_t* pSrc = reinterpret_cast<const pixel_t*>(pSrc8);
 
@@ -43,7 +103,7 @@ static void process_halfplane_c(const uint8_t* pSrc8, uint8_t* pDst8, int width,
 	for (int y = 1; y < height / 2; ++y) {
 		pDst[0] = (pSrc[srcPitch] + pSrc[-srcPitch] + (sizeof(pixel_t) == 4 ? 0 : 1)) / 2; // float: no round
 		for (int x = 1; x < width - 1; x += 1) {
-			pixel_t result = processor((uint8_t*)(pSrc + x), srcPitchOrig);
+			pixel_t result = call_processor<processor>((uint8_t*)(pSrc + x), srcPitchOrig, pixel_max);
 			pDst[x] = result;
 		}
 		pDst[width - 1] = (pSrc[width - 1 + srcPitch] + pSrc[width - 1 - srcPitch] + (sizeof(pixel_t) == 4 ? 0 : 1)) / 2; // float: no +1 rounding
@@ -57,251 +117,561 @@ static void process_halfplane_c(const uint8_t* pSrc8, uint8_t* pDst8, int width,
 	}
 }
 
-template<typename pixel_t, CModeProcessor<pixel_t> processor>
-static void process_even_rows_c(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch) {
+template<typename pixel_t, auto processor>
+static void process_even_rows_c(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max) {
 	vsh::bitblt(pDst, dstPitch, pSrc, srcPitch, width * sizeof(pixel_t), 2); //copy first two lines
 
-	process_halfplane_c<pixel_t, processor>(pSrc + srcPitch, pDst + dstPitch, width, height, srcPitch, dstPitch);
+	process_halfplane_c<pixel_t, processor>(pSrc + srcPitch, pDst + dstPitch, width, height, srcPitch, dstPitch, pixel_max);
 }
 
-template<typename pixel_t, CModeProcessor<pixel_t> processor>
-static void process_odd_rows_c(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch) {
+template<typename pixel_t, auto processor>
+static void process_odd_rows_c(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max) {
 	vsh::bitblt(pDst, dstPitch, pSrc, srcPitch, width * sizeof(pixel_t), 1); //top border
 
-	process_halfplane_c<pixel_t, processor>(pSrc, pDst, width, height, srcPitch, dstPitch);
+	process_halfplane_c<pixel_t, processor>(pSrc, pDst, width, height, srcPitch, dstPitch, pixel_max);
 
 	vsh::bitblt(pDst + dstPitch * (height - 1), dstPitch, pSrc + srcPitch * (height - 1), srcPitch, width * sizeof(pixel_t), 1); //bottom border
 }
 
-template<typename pixel_t>
-static void copyPlane(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch) {
-	vsh::bitblt(pDst, dstPitch, pSrc, srcPitch, width * sizeof(pixel_t), height);
-}
-
 static PlaneProcessor* c_functions[] = {
 	copyPlane<uint8_t>,
-	process_plane_c<uint8_t, rg_mode1_cpp>,
-	process_plane_c<uint8_t, rg_mode2_cpp>,
-	process_plane_c<uint8_t, rg_mode3_cpp>,
-	process_plane_c<uint8_t, rg_mode4_cpp>,
-	process_plane_c<uint8_t, rg_mode5_cpp>,
+	process_plane_rank_c<uint8_t, 1>,
+	process_plane_rank_c<uint8_t, 2>,
+	process_plane_rank_c<uint8_t, 3>,
+	process_plane_rank_c<uint8_t, 4>,
+	process_plane_c<uint8_t, rg_cpp<uint8_t, rg_mode5>>,
 	process_plane_c<uint8_t, rg_mode6_cpp>,
 	process_plane_c<uint8_t, rg_mode7_cpp>,
 	process_plane_c<uint8_t, rg_mode8_cpp>,
-	process_plane_c<uint8_t, rg_mode9_cpp>,
-	process_plane_c<uint8_t, rg_mode10_cpp>,
-	process_plane_c<uint8_t, rg_mode11_cpp>,
-	process_plane_c<uint8_t, rg_mode12_cpp>,
-	process_even_rows_c<uint8_t, rg_mode13_and14_cpp>,
-	process_odd_rows_c<uint8_t, rg_mode13_and14_cpp>,
+	process_plane_c<uint8_t, rg_cpp<uint8_t, rg_mode9>>,
+	process_plane_c<uint8_t, rg_cpp<uint8_t, rg_mode10>>,
+	process_plane_sep_c<uint8_t, 11>,
+	process_plane_sep_c<uint8_t, 12>,
+	process_even_rows_c<uint8_t, rg_cpp<uint8_t, rg_mode13_and14>>,
+	process_odd_rows_c<uint8_t, rg_cpp<uint8_t, rg_mode13_and14>>,
 	process_even_rows_c<uint8_t, rg_mode15_and16_cpp>,
 	process_odd_rows_c<uint8_t, rg_mode15_and16_cpp>,
-	process_plane_c<uint8_t, rg_mode17_cpp>,
-	process_plane_c<uint8_t, rg_mode18_cpp>,
+	process_plane_c<uint8_t, rg_cpp<uint8_t, rg_mode17>>,
+	process_plane_c<uint8_t, rg_cpp<uint8_t, rg_mode18>>,
 	process_plane_c<uint8_t, rg_mode19_cpp>,
-	process_plane_c<uint8_t, rg_mode20_cpp>,
+	process_plane_sep_c<uint8_t, 20>,
 	process_plane_c<uint8_t, rg_mode21_cpp>,
-	process_plane_c<uint8_t, rg_mode22_cpp>,
+	process_plane_c<uint8_t, rg_cpp<uint8_t, rg_mode22>>,
 	process_plane_c<uint8_t, rg_mode23_cpp>,
 	process_plane_c<uint8_t, rg_mode24_cpp>,
 	process_plane_c<uint8_t, rg_mode25_cpp>,
-	process_plane_c<uint8_t, rg_mode26_cpp>,
-	process_plane_c<uint8_t, rg_mode27_cpp>,
-	process_plane_c<uint8_t, rg_mode28_cpp>,
-};
-
-static PlaneProcessor* c_functions_10[] = {
-	copyPlane<uint16_t>,
-	process_plane_c<uint16_t, rg_mode1_cpp_16>,
-	process_plane_c<uint16_t, rg_mode2_cpp_16>,
-	process_plane_c<uint16_t, rg_mode3_cpp_16>,
-	process_plane_c<uint16_t, rg_mode4_cpp_16>,
-	process_plane_c<uint16_t, rg_mode5_cpp_16>,
-	process_plane_c<uint16_t, rg_mode6_cpp_16<10>>,
-	process_plane_c<uint16_t, rg_mode7_cpp_16>,
-	process_plane_c<uint16_t, rg_mode8_cpp_16<10>>,
-	process_plane_c<uint16_t, rg_mode9_cpp_16>,
-	process_plane_c<uint16_t, rg_mode10_cpp_16>,
-	process_plane_c<uint16_t, rg_mode11_cpp_16>,
-	process_plane_c<uint16_t, rg_mode12_cpp_16>,
-	process_even_rows_c<uint16_t, rg_mode13_and14_cpp_16>,
-	process_odd_rows_c<uint16_t, rg_mode13_and14_cpp_16>,
-	process_even_rows_c<uint16_t, rg_mode15_and16_cpp_16>,
-	process_odd_rows_c<uint16_t, rg_mode15_and16_cpp_16>,
-	process_plane_c<uint16_t, rg_mode17_cpp_16>,
-	process_plane_c<uint16_t, rg_mode18_cpp_16>,
-	process_plane_c<uint16_t, rg_mode19_cpp_16>,
-	process_plane_c<uint16_t, rg_mode20_cpp_16>,
-	process_plane_c<uint16_t, rg_mode21_cpp_16>,
-	process_plane_c<uint16_t, rg_mode22_cpp_16>,
-	process_plane_c<uint16_t, rg_mode23_cpp_16<10>>,
-	process_plane_c<uint16_t, rg_mode24_cpp_16<10>>,
-	process_plane_c<uint16_t, rg_mode25_cpp_16<10>>,
-	process_plane_c<uint16_t, rg_mode26_cpp_16>,
-	process_plane_c<uint16_t, rg_mode27_cpp_16>,
-	process_plane_c<uint16_t, rg_mode28_cpp_16>,
-};
-
-static PlaneProcessor* c_functions_12[] = {
-	copyPlane<uint16_t>,
-	process_plane_c<uint16_t, rg_mode1_cpp_16>,
-	process_plane_c<uint16_t, rg_mode2_cpp_16>,
-	process_plane_c<uint16_t, rg_mode3_cpp_16>,
-	process_plane_c<uint16_t, rg_mode4_cpp_16>,
-	process_plane_c<uint16_t, rg_mode5_cpp_16>,
-	process_plane_c<uint16_t, rg_mode6_cpp_16<12>>,
-	process_plane_c<uint16_t, rg_mode7_cpp_16>,
-	process_plane_c<uint16_t, rg_mode8_cpp_16<12>>,
-	process_plane_c<uint16_t, rg_mode9_cpp_16>,
-	process_plane_c<uint16_t, rg_mode10_cpp_16>,
-	process_plane_c<uint16_t, rg_mode11_cpp_16>,
-	process_plane_c<uint16_t, rg_mode12_cpp_16>,
-	process_even_rows_c<uint16_t, rg_mode13_and14_cpp_16>,
-	process_odd_rows_c<uint16_t, rg_mode13_and14_cpp_16>,
-	process_even_rows_c<uint16_t, rg_mode15_and16_cpp_16>,
-	process_odd_rows_c<uint16_t, rg_mode15_and16_cpp_16>,
-	process_plane_c<uint16_t, rg_mode17_cpp_16>,
-	process_plane_c<uint16_t, rg_mode18_cpp_16>,
-	process_plane_c<uint16_t, rg_mode19_cpp_16>,
-	process_plane_c<uint16_t, rg_mode20_cpp_16>,
-	process_plane_c<uint16_t, rg_mode21_cpp_16>,
-	process_plane_c<uint16_t, rg_mode22_cpp_16>,
-	process_plane_c<uint16_t, rg_mode23_cpp_16<12>>,
-	process_plane_c<uint16_t, rg_mode24_cpp_16<12>>,
-	process_plane_c<uint16_t, rg_mode25_cpp_16<12>>,
-	process_plane_c<uint16_t, rg_mode26_cpp_16>,
-	process_plane_c<uint16_t, rg_mode27_cpp_16>,
-	process_plane_c<uint16_t, rg_mode28_cpp_16>,
-};
-
-static PlaneProcessor* c_functions_14[] = {
-	copyPlane<uint16_t>,
-	process_plane_c<uint16_t, rg_mode1_cpp_16>,
-	process_plane_c<uint16_t, rg_mode2_cpp_16>,
-	process_plane_c<uint16_t, rg_mode3_cpp_16>,
-	process_plane_c<uint16_t, rg_mode4_cpp_16>,
-	process_plane_c<uint16_t, rg_mode5_cpp_16>,
-	process_plane_c<uint16_t, rg_mode6_cpp_16<14>>,
-	process_plane_c<uint16_t, rg_mode7_cpp_16>,
-	process_plane_c<uint16_t, rg_mode8_cpp_16<14>>,
-	process_plane_c<uint16_t, rg_mode9_cpp_16>,
-	process_plane_c<uint16_t, rg_mode10_cpp_16>,
-	process_plane_c<uint16_t, rg_mode11_cpp_16>,
-	process_plane_c<uint16_t, rg_mode12_cpp_16>,
-	process_even_rows_c<uint16_t, rg_mode13_and14_cpp_16>,
-	process_odd_rows_c<uint16_t, rg_mode13_and14_cpp_16>,
-	process_even_rows_c<uint16_t, rg_mode15_and16_cpp_16>,
-	process_odd_rows_c<uint16_t, rg_mode15_and16_cpp_16>,
-	process_plane_c<uint16_t, rg_mode17_cpp_16>,
-	process_plane_c<uint16_t, rg_mode18_cpp_16>,
-	process_plane_c<uint16_t, rg_mode19_cpp_16>,
-	process_plane_c<uint16_t, rg_mode20_cpp_16>,
-	process_plane_c<uint16_t, rg_mode21_cpp_16>,
-	process_plane_c<uint16_t, rg_mode22_cpp_16>,
-	process_plane_c<uint16_t, rg_mode23_cpp_16<14>>,
-	process_plane_c<uint16_t, rg_mode24_cpp_16<14>>,
-	process_plane_c<uint16_t, rg_mode25_cpp_16<14>>,
-	process_plane_c<uint16_t, rg_mode26_cpp_16>,
-	process_plane_c<uint16_t, rg_mode27_cpp_16>,
-	process_plane_c<uint16_t, rg_mode28_cpp_16>,
+	process_plane_c<uint8_t, rg_cpp<uint8_t, rg_mode26>>,
+	process_plane_c<uint8_t, rg_cpp<uint8_t, rg_mode27>>,
+	process_plane_c<uint8_t, rg_cpp<uint8_t, rg_mode28>>,
 };
 
+// 9-16 bit, the saturating modes read the pixel maximum at runtime
 static PlaneProcessor* c_functions_16[] = {
 	copyPlane<uint16_t>,
-	process_plane_c<uint16_t, rg_mode1_cpp_16>,
-	process_plane_c<uint16_t, rg_mode2_cpp_16>,
-	process_plane_c<uint16_t, rg_mode3_cpp_16>,
-	process_plane_c<uint16_t, rg_mode4_cpp_16>,
-	process_plane_c<uint16_t, rg_mode5_cpp_16>,
-	process_plane_c<uint16_t, rg_mode6_cpp_16<16>>,
+	process_plane_rank_c<uint16_t, 1>,
+	process_plane_rank_c<uint16_t, 2>,
+	process_plane_rank_c<uint16_t, 3>,
+	process_plane_rank_c<uint16_t, 4>,
+	process_plane_c<uint16_t, rg_cpp<uint16_t, rg_mode5>>,
+	process_plane_c<uint16_t, rg_mode6_cpp_16>,
 	process_plane_c<uint16_t, rg_mode7_cpp_16>,
-	process_plane_c<uint16_t, rg_mode8_cpp_16<16>>,
-	process_plane_c<uint16_t, rg_mode9_cpp_16>,
-	process_plane_c<uint16_t, rg_mode10_cpp_16>,
-	process_plane_c<uint16_t, rg_mode11_cpp_16>,
-	process_plane_c<uint16_t, rg_mode12_cpp_16>,
-	process_even_rows_c<uint16_t, rg_mode13_and14_cpp_16>,
-	process_odd_rows_c<uint16_t, rg_mode13_and14_cpp_16>,
+	process_plane_c<uint16_t, rg_mode8_cpp_16>,
+	process_plane_c<uint16_t, rg_cpp<uint16_t, rg_mode9>>,
+	process_plane_c<uint16_t, rg_cpp<uint16_t, rg_mode10>>,
+	process_plane_sep_c<uint16_t, 11>,
+	process_plane_sep_c<uint16_t, 12>,
+	process_even_rows_c<uint16_t, rg_cpp<uint16_t, rg_mode13_and14>>,
+	process_odd_rows_c<uint16_t, rg_cpp<uint16_t, rg_mode13_and14>>,
 	process_even_rows_c<uint16_t, rg_mode15_and16_cpp_16>,
 	process_odd_rows_c<uint16_t, rg_mode15_and16_cpp_16>,
-	process_plane_c<uint16_t, rg_mode17_cpp_16>,
-	process_plane_c<uint16_t, rg_mode18_cpp_16>,
+	process_plane_c<uint16_t, rg_cpp<uint16_t, rg_mode17>>,
+	process_plane_c<uint16_t, rg_cpp<uint16_t, rg_mode18>>,
 	process_plane_c<uint16_t, rg_mode19_cpp_16>,
-	process_plane_c<uint16_t, rg_mode20_cpp_16>,
+	process_plane_sep_c<uint16_t, 20>,
 	process_plane_c<uint16_t, rg_mode21_cpp_16>,
-	process_plane_c<uint16_t, rg_mode22_cpp_16>,
-	process_plane_c<uint16_t, rg_mode23_cpp_16<16>>,
-	process_plane_c<uint16_t, rg_mode24_cpp_16<16>>,
-	process_plane_c<uint16_t, rg_mode25_cpp_16<16>>,
-	process_plane_c<uint16_t, rg_mode26_cpp_16>,
-	process_plane_c<uint16_t, rg_mode27_cpp_16>,
-	process_plane_c<uint16_t, rg_mode28_cpp_16>,
+	process_plane_c<uint16_t, rg_cpp<uint16_t, rg_mode22>>,
+	process_plane_c<uint16_t, rg_mode23_cpp_16>,
+	process_plane_c<uint16_t, rg_mode24_cpp_16>,
+	process_plane_c<uint16_t, rg_mode25_cpp_16>,
+	process_plane_c<uint16_t, rg_cpp<uint16_t, rg_mode26>>,
+	process_plane_c<uint16_t, rg_cpp<uint16_t, rg_mode27>>,
+	process_plane_c<uint16_t, rg_cpp<uint16_t, rg_mode28>>,
 };
 
 static PlaneProcessor* c_functions_32_luma[] = {
 	copyPlane<float>,
-	process_plane_c<float, rg_mode1_cpp_32>,
-	process_plane_c<float, rg_mode2_cpp_32>,
-	process_plane_c<float, rg_mode3_cpp_32>,
-	process_plane_c<float, rg_mode4_cpp_32>,
-	process_plane_c<float, rg_mode5_cpp_32>,
+	process_plane_rank_c<float, 1>,
+	process_plane_rank_c<float, 2>,
+	process_plane_rank_c<float, 3>,
+	process_plane_rank_c<float, 4>,
+	process_plane_c<float, rg_cpp<float, rg_mode5>>,
 	process_plane_c<float, rg_mode6_cpp_32>,
 	process_plane_c<float, rg_mode7_cpp_32>,
 	process_plane_c<float, rg_mode8_cpp_32>,
-	process_plane_c<float, rg_mode9_cpp_32>,
-	process_plane_c<float, rg_mode10_cpp_32>,
-	process_plane_c<float, rg_mode11_cpp_32>,
-	process_plane_c<float, rg_mode12_cpp_32>,
-	process_even_rows_c<float, rg_mode13_and14_cpp_32>,
-	process_odd_rows_c<float, rg_mode13_and14_cpp_32>,
+	process_plane_c<float, rg_cpp<float, rg_mode9>>,
+	process_plane_c<float, rg_cpp<float, rg_mode10>>,
+	process_plane_sep_c<float, 11>,
+	process_plane_sep_c<float, 12>,
+	process_even_rows_c<float, rg_cpp<float, rg_mode13_and14>>,
+	process_odd_rows_c<float, rg_cpp<float, rg_mode13_and14>>,
 	process_even_rows_c<float, rg_mode15_and16_cpp_32>,
 	process_odd_rows_c<float, rg_mode15_and16_cpp_32>,
-	process_plane_c<float, rg_mode17_cpp_32>,
-	process_plane_c<float, rg_mode18_cpp_32>,
+	process_plane_c<float, rg_cpp<float, rg_mode17>>,
+	process_plane_c<float, rg_cpp<float, rg_mode18>>,
 	process_plane_c<float, rg_mode19_cpp_32>,
-	process_plane_c<float, rg_mode20_cpp_32>,
+	process_plane_sep_c<float, 20>,
 	process_plane_c<float, rg_mode21_cpp_32>,
-	process_plane_c<float, rg_mode22_cpp_32>,
+	process_plane_c<float, rg_cpp<float, rg_mode22>>,
 	process_plane_c<float, rg_mode23_cpp_32<false>>,
 	process_plane_c<float, rg_mode24_cpp_32<false>>,
 	process_plane_c<float, rg_mode25_cpp_32<false>>, // false: luma, true: chroma
-	process_plane_c<float, rg_mode26_cpp_32>,
-	process_plane_c<float, rg_mode27_cpp_32>,
-	process_plane_c<float, rg_mode28_cpp_32>,
+	process_plane_c<float, rg_cpp<float, rg_mode26>>,
+	process_plane_c<float, rg_cpp<float, rg_mode27>>,
+	process_plane_c<float, rg_cpp<float, rg_mode28>>,
 };
 
 static PlaneProcessor* c_functions_32_chroma[] = {
 	copyPlane<float>,
-	process_plane_c<float, rg_mode1_cpp_32>,
-	process_plane_c<float, rg_mode2_cpp_32>,
-	process_plane_c<float, rg_mode3_cpp_32>,
-	process_plane_c<float, rg_mode4_cpp_32>,
-	process_plane_c<float, rg_mode5_cpp_32>,
+	process_plane_rank_c<float, 1>,
+	process_plane_rank_c<float, 2>,
+	process_plane_rank_c<float, 3>,
+	process_plane_rank_c<float, 4>,
+	process_plane_c<float, rg_cpp<float, rg_mode5>>,
 	process_plane_c<float, rg_mode6_cpp_32>,
 	process_plane_c<float, rg_mode7_cpp_32>,
 	process_plane_c<float, rg_mode8_cpp_32>,
-	process_plane_c<float, rg_mode9_cpp_32>,
-	process_plane_c<float, rg_mode10_cpp_32>,
-	process_plane_c<float, rg_mode11_cpp_32>,
-	process_plane_c<float, rg_mode12_cpp_32>,
-	process_even_rows_c<float, rg_mode13_and14_cpp_32>,
-	process_odd_rows_c<float, rg_mode13_and14_cpp_32>,
+	process_plane_c<float, rg_cpp<float, rg_mode9>>,
+	process_plane_c<float, rg_cpp<float, rg_mode10>>,
+	process_plane_sep_c<float, 11>,
+	process_plane_sep_c<float, 12>,
+	process_even_rows_c<float, rg_cpp<float, rg_mode13_and14>>,
+	process_odd_rows_c<float, rg_cpp<float, rg_mode13_and14>>,
 	process_even_rows_c<float, rg_mode15_and16_cpp_32>,
 	process_odd_rows_c<float, rg_mode15_and16_cpp_32>,
-	process_plane_c<float, rg_mode17_cpp_32>,
-	process_plane_c<float, rg_mode18_cpp_32>,
+	process_plane_c<float, rg_cpp<float, rg_mode17>>,
+	process_plane_c<float, rg_cpp<float, rg_mode18>>,
 	process_plane_c<float, rg_mode19_cpp_32>,
-	process_plane_c<float, rg_mode20_cpp_32>,
+	process_plane_sep_c<float, 20>,
 	process_plane_c<float, rg_mode21_cpp_32>,
-	process_plane_c<float, rg_mode22_cpp_32>,
+	process_plane_c<float, rg_cpp<float, rg_mode22>>,
 	process_plane_c<float, rg_mode23_cpp_32<true>>,
 	process_plane_c<float, rg_mode24_cpp_32<true>>,
 	process_plane_c<float, rg_mode25_cpp_32<true>>, // false: luma, true: chroma
-	process_plane_c<float, rg_mode26_cpp_32>,
-	process_plane_c<float, rg_mode27_cpp_32>,
-	process_plane_c<float, rg_mode28_cpp_32>,
+	process_plane_c<float, rg_cpp<float, rg_mode26>>,
+	process_plane_c<float, rg_cpp<float, rg_mode27>>,
+	process_plane_c<float, rg_cpp<float, rg_mode28>>,
+};
+
+static PlaneProcessor** get_c_functions(int bits_per_pixel, bool chroma) {
+	switch (bits_per_pixel) {
+	case 8: return c_functions;
+	case 32: return chroma ? c_functions_32_chroma : c_functions_32_luma;
+	}
+	if (bits_per_pixel > 8 && bits_per_pixel <= 16)
+		return c_functions_16;
+	return nullptr;
+}
+
+// highest opt value the CPU can run
+int get_cpu_opt() {
+	const int iset = instrset_detect();
+	// AVX512BW/VL, instrset_detect() also checks that the OS saves the ZMM and mask registers
+	if (iset >= 10 && hasFMA3())
+		return 5;
+	if (iset >= 8 && hasFMA3()) // the float AVX2 kernels use FMA
+		return 4;
+	if (iset >= 5)
+		return 3;
+	if (iset >= 2)
+		return 2;
+	return 1;
+}
+
+// best table up to the given opt level, an instruction set without a table for the format falls back to the next one
+static PlaneProcessor** select_functions(int opt, int bits_per_pixel, bool chroma, bool aligned, bool stream) {
+	PlaneProcessor** functions = nullptr;
+	if (opt >= 5)
+		functions = avx512_functions(bits_per_pixel, chroma, aligned, stream);
+	if (!functions && opt >= 4)
+		functions = avx2_functions(bits_per_pixel, chroma, aligned, stream);
+	if (!functions && opt >= 3)
+		functions = sse4_functions(bits_per_pixel, chroma, aligned, stream);
+	if (!functions && opt >= 2)
+		functions = sse2_functions(bits_per_pixel, chroma, aligned, stream);
+	if (!functions)
+		functions = get_c_functions(bits_per_pixel, chroma);
+	return functions;
+}
+
+// fp16 clips only have AVX2 and AVX-512 tables, nullptr below that
+static PlaneProcessor** select_half_functions(int opt, bool chroma, bool aligned, bool stream) {
+	if (opt >= 5)
+		return avx512_half_functions(chroma, aligned, stream);
+	if (opt >= 4)
+		return avx2_half_functions(chroma, aligned, stream);
+	return nullptr;
+}
+
+// Luma plane size in bytes above which stream=-1 picks streaming stores. Larger planes do not stay in L2
+// until the next filter reads them, writing around the cache keeps the source rows there instead.
+static constexpr int64_t stream_threshold = 8 << 20;
+
+// Whether every plane width is a multiple of the vector size of the opt level, then the tables
+// with aligned row loops are used. Variable format clips use the generic ones.
+static bool has_aligned_widths(const VSVideoInfo* vi, int opt) {
+	if (opt < 2 || !vsh::isConstantVideoFormat(vi))
+		return false;
+	const int vector_bytes = opt >= 5 ? 64 : opt >= 4 ? 32 : 16;
+	for (int plane = 0; plane < vi->format.numPlanes; plane++) {
+		const int width = plane ? vi->width >> vi->format.subSamplingW : vi->width;
+		if ((width * vi->format.bytesPerSample) % vector_bytes)
+			return false;
+	}
+	return true;
+}
+
+static PlaneProcessor* get_c_exact_function(int bits_per_pixel, int mode) {
+	if (bits_per_pixel == 8) {
+		if (mode == 12)
+			return process_plane_c<uint8_t, rg_mode12_exact_cpp<uint8_t>>;
+		if (mode == 19)
+			return process_plane_c<uint8_t, rg_mode19_exact_cpp<uint8_t>>;
+	}
+	else if (bits_per_pixel > 8 && bits_per_pixel <= 16) {
+		if (mode == 12)
+			return process_plane_c<uint16_t, rg_mode12_exact_cpp<uint16_t>>;
+		if (mode == 19)
+			return process_plane_c<uint16_t, rg_mode19_exact_cpp<uint16_t>>;
+	}
+	return nullptr;
+}
+
+// exact=True kernel for the mode, same walk as select_functions. Every instruction set has the
+// same set of exact kernels, so the first one tried decides whether the mode has one at all.
+static PlaneProcessor* select_exact_function(int opt, int bits_per_pixel, int mode) {
+	if (opt >= 5)
+		return avx512_exact_function(bits_per_pixel, mode);
+	if (opt >= 4)
+		return avx2_exact_function(bits_per_pixel, mode);
+	if (opt >= 3)
+		return sse4_exact_function(bits_per_pixel, mode);
+	if (opt >= 2)
+		return sse2_exact_function(bits_per_pixel, mode);
+	return get_c_exact_function(bits_per_pixel, mode);
+}
+
+// L1 data share of one strip row: the three source rows and the destination row of a strip fit in
+// four of them. Rows wider than two of them are processed in strips.
+static constexpr int strip_row_bytes = 4 << 10;
+
+// Processes the plane in vertical strips sized to the L1 cache, the result is the same as one call.
+// Every strip is processed together with one cache line of columns left and right of it, so each call
+// starts on a cache line and covers whole vectors, and the aligned tables keep their aligned row loop.
+// The processor copies the outermost columns from the source as edge columns and computes the others
+// from their real neighbours, the same values as the neighbouring strip. Strips run left to right, each
+// puts back the edge column of the previous strip it overwrote, its right one is computed by the next.
+static void process_plane_strips(PlaneProcessor* processor, bool tiled, int pixel_size, const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max) {
+	const int64_t row_bytes = static_cast<int64_t>(width) * pixel_size;
+	if (!tiled || row_bytes <= 2 * strip_row_bytes) {
+		processor(pSrc, pDst, width, height, srcPitch, dstPitch, pixel_max);
+		return;
+	}
+
+	// equal strips of whole cache lines
+	const int strips = static_cast<int>((row_bytes + strip_row_bytes - 1) / strip_row_bytes);
+	const int line_pixels = 64 / pixel_size;
+	const int strip_width = ((width + strips - 1) / strips + line_pixels - 1) / line_pixels * line_pixels;
+
+	std::unique_ptr<uint8_t[]> saved(new uint8_t[static_cast<size_t>(height) * pixel_size]);
+	for (int left = 0; left < width; left += strip_width) {
+		const int first = left ? left - line_pixels : 0;
+		const int last = std::min(left + strip_width + line_pixels, width);
+		uint8_t* pLeft = pDst + first * pixel_size;
+
+		if (left) {
+			for (int y = 0; y < height; ++y)
+				memcpy(saved.get() + y * pixel_size, pLeft + y * dstPitch, pixel_size);
+		}
+
+		processor(pSrc + first * pixel_size, pLeft, last - first, height, srcPitch, dstPitch, pixel_max);
+
+		if (left) {
+			for (int y = 0; y < height; ++y)
+				memcpy(pLeft + y * dstPitch, saved.get() + y * pixel_size, pixel_size);
+		}
+	}
+}
+
+// Bands are at least this many rows, smaller planes are not split.
+static constexpr int min_band_rows = 16;
+
+// Splits the plane into horizontal bands processed on the pool, the result is the same as one call.
+// Every band is processed together with the row above and below it, which the processor copies
+// from the source as edge rows. The even bands run first, then the odd ones, which put back the
+// rows of their neighbours they overwrote. Bands start on odd rows and have an even number of rows,
+// so the field modes 13-16 see the same row parity as on the whole plane.
+static void process_plane_bands(PlaneProcessor* processor, const RgToolsData* d, int pixel_size, const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch) {
+	const int bands = d->pool ? std::min(2 * d->threads, height / min_band_rows) : 1;
+	if (bands < 2) {
+		process_plane_strips(processor, d->tiled, pixel_size, pSrc, pDst, width, height, srcPitch, dstPitch, d->pixel_max);
+		return;
+	}
+
+	auto band_top = [=](int band) {
+		return band == bands ? height : band ? static_cast<int>(static_cast<int64_t>(height) * band / bands) | 1 : 0;
+	};
+	const size_t row_size = static_cast<size_t>(width) * pixel_size;
+
+	auto process_band = [&](int band) {
+		const int top = band_top(band);
+		const int bottom = band_top(band + 1);
+		const int first = std::max(top - 1, 0);
+		const int last = std::min(bottom + 1, height);
+		uint8_t* pAbove = top > 0 ? pDst + (top - 1) * dstPitch : nullptr;
+		uint8_t* pBelow = bottom < height ? pDst + bottom * dstPitch : nullptr;
+
+		std::unique_ptr<uint8_t[]> saved;
+		if (band & 1) {
+			saved.reset(new uint8_t[2 * row_size]);
+			if (pAbove)
+				memcpy(saved.get(), pAbove, row_size);
+			if (pBelow)
+				memcpy(saved.get() + row_size, pBelow, row_size);
+		}
+
+		process_plane_strips(processor, d->tiled, pixel_size, pSrc + first * srcPitch, pDst + first * dstPitch, width, last - first, srcPitch, dstPitch, d->pixel_max);
+
+		if (band & 1) {
+			if (pAbove)
+				memcpy(pAbove, saved.get(), row_size);
+			if (pBelow)
+				memcpy(pBelow, saved.get() + row_size, row_size);
+		}
+	};
+
+	d->pool->run((bands + 1) / 2, [&](int i) { process_band(2 * i); });
+	d->pool->run(bands / 2, [&](int i) { process_band(2 * i + 1); });
+}
+
+// Rows per chunk of a mode list, even so the chunks keep the row parity of the field modes.
+static constexpr int chain_rows = 16;
+
+static int chain_chunks(int height) {
+	return std::max((height + chain_rows) / chain_rows, 1);
+}
+
+// first row of a chunk, odd for all but the first like the band tops
+static int chain_chunk_top(int chunk, int chunks, int height) {
+	return chunk == chunks ? height : chunk ? chunk * chain_rows - 1 : 0;
+}
+
+// Runs the processors of a mode list over the plane in one pass, the result is the same as one
+// call per mode with a full frame in between. The plane is cut into chunks of chain_rows rows like
+// the bands, odd tops and even heights. Every stage processes a chunk together with the row above
+// and below it once the previous stage is a chunk ahead, and writes it to a small rolling buffer of
+// rows the next stage reads, only the last stage writes the destination. A stage puts back the row
+// above its chunk it overwrote, the row below is computed with its next chunk.
+static void process_plane_chain(PlaneProcessor* const* stages, int count, int pixel_size, const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max) {
+	const int chunks = chain_chunks(height);
+	auto chunk_top = [=](int chunk) { return chain_chunk_top(chunk, chunks, height); };
+
+	// a stage holds at most the row above the previous chunk up to the row below the current one
+	const int capacity = std::min(3 * chain_rows + 4, height);
+	const ptrdiff_t pitch = (static_cast<ptrdiff_t>(width) * pixel_size + 63) & ~static_cast<ptrdiff_t>(63);
+	std::unique_ptr<uint8_t[]> buffer(new uint8_t[(count - 1) * capacity * pitch + 63]);
+	uint8_t* pBuffer = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(buffer.get()) + 63) & ~static_cast<uintptr_t>(63));
+	std::vector<int> base(count, 0); // first row held by the buffer of each stage
+
+	auto out_pitch = [&](int stage) { return stage == count - 1 ? dstPitch : pitch; };
+	auto out_row = [&](int stage, int y) {
+		return stage == count - 1 ? pDst + y * dstPitch : pBuffer + (stage * capacity + y - base[stage]) * pitch;
+	};
+	const size_t row_size = static_cast<size_t>(width) * pixel_size;
+	std::unique_ptr<uint8_t[]> saved(new uint8_t[row_size]);
+
+	auto process_chunk = [&](int stage, int chunk) {
+		const int top = chunk_top(chunk);
+		const int first = std::max(top - 1, 0);
+		const int last = std::min(chunk_top(chunk + 1) + 1, height);
+
+		// drop the rows the next stage is done with, it still reads the previous chunk in this step
+		if (stage < count - 1 && last - base[stage] > capacity) {
+			const int keep = std::max(chunk_top(chunk - 1) - 1, 0);
+			uint8_t* pStage = pBuffer + stage * capacity * pitch;
+			memmove(pStage, pStage + (keep - base[stage]) * pitch, (first + 2 - keep) * pitch);
+			base[stage] = keep;
+		}
+
+		const uint8_t* pIn = stage ? out_row(stage - 1, first) : pSrc + first * srcPitch;
+		uint8_t* pOut = out_row(stage, first);
+		if (top)
+			memcpy(saved.get(), pOut, row_size);
+		stages[stage](pIn, pOut, width, last - first, stage ? pitch : srcPitch, out_pitch(stage), pixel_max);
+		if (top)
+			memcpy(pOut, saved.get(), row_size);
+	};
+
+	for (int step = 0; step < chunks + count - 1; ++step) {
+		for (int stage = 0; stage < count; ++stage) {
+			const int chunk = step - stage;
+			if (chunk >= 0 && chunk < chunks)
+				process_chunk(stage, chunk);
+		}
+	}
+}
+
+// Runs several processors over the same source plane chunk by chunk, every processor writes its own
+// destination. The chunks are the ones of process_plane_chain, so every processor reads the source
+// rows of a chunk while the previous one left them in the cache.
+static void process_plane_multi(PlaneProcessor* const* functions, int count, int pixel_size, const uint8_t* pSrc, uint8_t* const* pDsts, const ptrdiff_t* dstPitches, int width, int height, ptrdiff_t srcPitch, int pixel_max) {
+	const int chunks = chain_chunks(height);
+	const size_t row_size = static_cast<size_t>(width) * pixel_size;
+	std::unique_ptr<uint8_t[]> saved(new uint8_t[row_size]);
+
+	for (int chunk = 0; chunk < chunks; ++chunk) {
+		const int top = chain_chunk_top(chunk, chunks, height);
+		const int first = std::max(top - 1, 0);
+		const int last = std::min(chain_chunk_top(chunk + 1, chunks, height) + 1, height);
+
+		for (int i = 0; i < count; ++i) {
+			uint8_t* pOut = pDsts[i] + first * dstPitches[i];
+			if (top)
+				memcpy(saved.get(), pOut, row_size);
+			functions[i](pSrc + first * srcPitch, pOut, width, last - first, srcPitch, dstPitches[i], pixel_max);
+			if (top)
+				memcpy(pOut, saved.get(), row_size);
+		}
+	}
+}
+
+// border=1 (repeat) and 2 (mirror): the plane is processed like border=0, then the edge rows and columns
+// are done again from small copies of them together with their outer neighbours, four rows of width + 2
+// pixels and three columns of height + 2 rows. The processor covers the edge pixels with its usual row
+// loops and only the perimeter is copied. Mirroring skips the edge pixel, -1 is read from 1. A dimension
+// of 1 pixel is repeated instead.
+// The result is the one of the processor run over the plane padded by one pixel: padded is that processor,
+// the mode of the other field for modes 13-16 and processor for every other mode. field is the parity of
+// the rows modes 13-16 process, -1 for every other mode. Over the padded plane they also cover the first
+// row (even field) or the last row of the odd field, and the edge pixels of their rows are filtered
+// instead of averaged.
+static void process_plane_edges(PlaneProcessor* processor, PlaneProcessor* padded, int field, int border, int pixel_size, const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max) {
+	const bool mirror_x = border == 2 && width > 1;
+	const bool mirror_y = border == 2 && height > 1;
+	auto source_x = [=](int x) { return x < 0 ? (mirror_x ? 1 : 0) : x >= width ? (mirror_x ? width - 2 : width - 1) : x; };
+	auto source_y = [=](int y) { return y < 0 ? (mirror_y ? 1 : 0) : y >= height ? (mirror_y ? height - 2 : height - 1) : y; };
+	auto source = [&](int x, int y) { return pSrc + source_y(y) * srcPitch + source_x(x) * pixel_size; };
+
+	const ptrdiff_t row_pitch = static_cast<ptrdiff_t>(width + 2) * pixel_size;
+	const ptrdiff_t column_pitch = 3 * pixel_size;
+	const size_t row_bytes = 4 * row_pitch;
+	const size_t column_bytes = static_cast<size_t>(height + 2) * column_pitch;
+	std::unique_ptr<uint8_t[]> buffer(new uint8_t[2 * (row_bytes + column_bytes)]);
+	uint8_t* pRows = buffer.get();
+	uint8_t* pRowsResult = pRows + row_bytes;
+	uint8_t* pColumns = pRowsResult + row_bytes;
+	uint8_t* pColumnsResult = pColumns + column_bytes;
+
+	// rows y - 1 .. y + 2, the odd field modes process the second one of four rows
+	PlaneProcessor* row_processor = field == 0 ? padded : processor;
+	auto edge_row = [&](int y) {
+		for (int k = 0; k < 4; ++k) {
+			uint8_t* row = pRows + k * row_pitch;
+			memcpy(row, source(-1, y - 1 + k), pixel_size);
+			memcpy(row + pixel_size, source(0, y - 1 + k), width * pixel_size);
+			memcpy(row + (width + 1) * pixel_size, source(width, y - 1 + k), pixel_size);
+		}
+		row_processor(pRows, pRowsResult, width + 2, 4, row_pitch, row_pitch, pixel_max);
+		memcpy(pDst + y * dstPitch, pRowsResult + row_pitch + pixel_size, width * pixel_size);
+	};
+
+	// columns left .. left + 2 of rows -1 .. height, the middle one is the edge column
+	auto edge_column = [&](int left) {
+		for (int y = -1; y <= height; ++y)
+			for (int k = 0; k < 3; ++k)
+				memcpy(pColumns + (y + 1) * column_pitch + k * pixel_size, source(left + k, y), pixel_size);
+		padded(pColumns, pColumnsResult, 3, height + 2, column_pitch, column_pitch, pixel_max);
+		for (int y = 0; y < height; ++y)
+			memcpy(pDst + y * dstPitch + (left + 1) * pixel_size, pColumnsResult + (y + 1) * column_pitch + pixel_size, pixel_size);
+	};
+
+	if (field < 0) {
+		edge_row(0);
+		if (height > 1)
+			edge_row(height - 1);
+	}
+	else if (field == 0) {
+		if (height > 1)
+			edge_row(0);
+	}
+	else {
+		const int last = (height & 1) ? height - 2 : height - 1;
+		if (last > 0)
+			edge_row(last);
+	}
+	edge_column(-1);
+	if (width > 1)
+		edge_column(width - 2);
+}
+
+// One plane of a staged call, see process_planes_staged.
+struct StagedPlane final {
+	const uint8_t* src;
+	uint8_t* dst;
+	ptrdiff_t src_pitch;
+	ptrdiff_t dst_pitch;
 };
 
+// Runs the processor over planes of the same size placed side by side, row y of every plane in staged
+// row y. U and V of subsampled clips go through here together, so the row loops see one row of twice the
+// width instead of two narrow ones. The planes are staged in the chunks of the mode lists together with
+// the row above and below, into a buffer that stays in cache with its result, so the copies in and out
+// are not two more passes over memory. With a pool the chunks are split into threads tasks.
+// The planes touch, the columns next to a seam read the other plane and are copied back from the source
+// like every other edge column. Modes 13-16 average their edge pixels instead and cannot be staged.
+static void process_planes_staged(PlaneProcessor* processor, const RgToolsData* d, int pixel_size, const StagedPlane* planes, int count, int width, int height) {
+	const int staged_width = width * count;
+	const ptrdiff_t pitch = (static_cast<ptrdiff_t>(staged_width) * pixel_size + 63) & ~static_cast<ptrdiff_t>(63);
+	const size_t row_size = static_cast<size_t>(width) * pixel_size;
+	const int chunks = chain_chunks(height);
+	const int capacity = std::min(chain_rows + 2, height);
+
+	auto process_chunks = [&](int begin, int end) {
+		std::unique_ptr<uint8_t[]> buffer(new uint8_t[2 * pitch * capacity + 63]);
+		uint8_t* pStaged = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(buffer.get()) + 63) & ~static_cast<uintptr_t>(63));
+		uint8_t* pResult = pStaged + pitch * capacity;
+
+		for (int chunk = begin; chunk < end; ++chunk) {
+			const int top = chain_chunk_top(chunk, chunks, height);
+			const int bottom = chain_chunk_top(chunk + 1, chunks, height);
+			const int first = std::max(top - 1, 0);
+			const int last = std::min(bottom + 1, height);
+
+			for (int p = 0; p < count; ++p)
+				vsh::bitblt(pStaged + p * row_size, pitch, planes[p].src + first * planes[p].src_pitch, planes[p].src_pitch, row_size, last - first);
+
+			process_plane_strips(processor, d->tiled, pixel_size, pStaged, pResult, staged_width, last - first, pitch, pitch, d->pixel_max);
+
+			for (int p = 0; p < count; ++p) {
+				vsh::bitblt(planes[p].dst + top * planes[p].dst_pitch, planes[p].dst_pitch, pResult + (top - first) * pitch + p * row_size, pitch, row_size, bottom - top);
+				for (int y = top; y < bottom; ++y) {
+					const uint8_t* src_row = planes[p].src + y * planes[p].src_pitch;
+					uint8_t* dst_row = planes[p].dst + y * planes[p].dst_pitch;
+					if (p > 0)
+						memcpy(dst_row, src_row, pixel_size);
+					if (p < count - 1)
+						memcpy(dst_row + (width - 1) * pixel_size, src_row + (width - 1) * pixel_size, pixel_size);
+				}
+			}
+		}
+	};
+
+	const int tasks = d->pool ? std::min(d->threads, chunks) : 1;
+	if (tasks < 2) {
+		process_chunks(0, chunks);
+		return;
+	}
+	d->pool->run(tasks, [&](int task) { process_chunks(chunks * task / tasks, chunks * (task + 1) / tasks); });
+}
 
 static const VSFrame* VS_CC rgToolsGetFrame(int n, int activationReason, void* instanceData, void** frameData, VSFrameContext* frameCtx, VSCore* core, const VSAPI* vsapi) {
 	auto d{ static_cast<RgToolsData*>(instanceData) };
@@ -316,23 +686,53 @@ static const VSFrame* VS_CC rgToolsGetFrame(int n, int activationReason, void* i
 		int srcw = vsapi->getFrameWidth(src, 0);
 		VSFrame* dst = vsapi->newVideoFrame(fi, srcw, srch, src, core);
 
-		for (int plane{ 0 }; plane < d->vi->format.numPlanes; plane++) {
-			const uint8_t* srcp = vsapi->getReadPtr(src, plane);
-			const ptrdiff_t src_pitch = vsapi->getStride(src, plane);
-			uint8_t* dstp = vsapi->getWritePtr(dst, plane);
-			ptrdiff_t dst_pitch = vsapi->getStride(dst, plane);
-			const int width{ vsapi->getFrameWidth(src, plane) };
-			const int height{ vsapi->getFrameHeight(src, plane) };
+		// pointers are taken here, the plane tasks may run on the pool
+		const int num_planes = d->vi->format.numPlanes;
+		StagedPlane planes[3];
+		for (int plane{ 0 }; plane < num_planes; plane++)
+			planes[plane] = { vsapi->getReadPtr(src, plane), vsapi->getWritePtr(dst, plane), vsapi->getStride(src, plane), vsapi->getStride(dst, plane) };
+		const int chroma_width = vsapi->getFrameWidth(src, num_planes - 1);
+		const int chroma_height = vsapi->getFrameHeight(src, num_planes - 1);
+
+		auto process_plane = [&](int plane) {
+			const StagedPlane& p = planes[plane];
+			const int width{ plane ? chroma_width : srcw };
+			const int height{ plane ? chroma_height : srch };
 
-			if (plane &&
+			const bool chroma = plane &&
 				d->vi->format.colorFamily != cfRGB &&
-				d->vi->format.sampleType == stFloat) {
-				d->functions_chroma[d->mode](srcp, dstp, width, height, src_pitch, dst_pitch);
+				d->vi->format.sampleType == stFloat;
+
+			if (!d->chain.empty()) {
+				const std::vector<PlaneProcessor*>& stages = chroma ? d->chain_chroma : d->chain;
+				process_plane_chain(stages.data(), static_cast<int>(stages.size()), fi->bytesPerSample, p.src, p.dst, width, height, p.src_pitch, p.dst_pitch, d->pixel_max);
+				return;
 			}
-			else {
-				d->functions[d->mode](srcp, dstp, width, height, src_pitch, dst_pitch);
+
+			PlaneProcessor* const* functions = chroma ? d->functions_chroma : d->functions;
+			PlaneProcessor* function = d->exact_function ? d->exact_function : functions[d->mode];
+
+			const bool interleaved = plane == 1 && d->interleave_chroma;
+			if (interleaved) // U and V in one call
+				process_planes_staged(function, d, fi->bytesPerSample, planes + 1, 2, width, height);
+			else
+				process_plane_bands(function, d, fi->bytesPerSample, p.src, p.dst, width, height, p.src_pitch, p.dst_pitch);
+
+			if (d->border && d->mode) {
+				const bool field_mode = d->mode >= 13 && d->mode <= 16;
+				PlaneProcessor* padded = field_mode ? functions[d->mode + ((d->mode & 1) ? 1 : -1)] : function;
+				for (int i = plane; i < (interleaved ? 3 : plane + 1); i++)
+					process_plane_edges(function, padded, field_mode ? (d->mode + 1) & 1 : -1, d->border, fi->bytesPerSample, planes[i].src, planes[i].dst, width, height, planes[i].src_pitch, planes[i].dst_pitch, d->pixel_max);
 			}
-		}
+		};
+
+		// the planes are independent, with parallel_planes they are tasks of their own and their bands nest inside
+		const int plane_tasks = d->interleave_chroma ? 2 : num_planes;
+		if (d->parallel_planes)
+			d->pool->run(plane_tasks, process_plane);
+		else
+			for (int plane{ 0 }; plane < plane_tasks; plane++)
+				process_plane(plane);
 
 		vsapi->freeFrame(src);
 		return dst;
@@ -353,31 +753,359 @@ void VS_CC rgToolsCreate(const VSMap* in, VSMap* out, void* userData, VSCore* co
 	d->node = vsapi->mapGetNode(in, "clip", 0, nullptr);
 	d->vi = vsapi->getVideoInfo(d->node);
 
-	d->mode = vsapi->mapGetIntSaturated(in, "mode", 0, &err);
+	// a list of modes runs them one after another in a single pass, see process_plane_chain
+	std::vector<int> modes;
+	const int num_modes = vsapi->mapNumElements(in, "mode");
+	for (int i = 0; i < num_modes; i++)
+		modes.push_back(vsapi->mapGetIntSaturated(in, "mode", i, nullptr));
+	const bool has_mode = num_modes > 0;
+
+	// clip between the rank-th smallest and the rank-th largest neighbour, the rank engine behind modes 1-4
+	const int rank = vsapi->mapGetIntSaturated(in, "rank", 0, &err);
+	if (!err) {
+		if (has_mode) {
+			vsapi->mapSetError(out, "RemoveGrain: mode and rank cannot be used together");
+			vsapi->freeNode(d->node);
+			return;
+		}
+		if (rank < 1 || rank > 4) {
+			vsapi->mapSetError(out, "RemoveGrain: rank must be between 1 and 4");
+			vsapi->freeNode(d->node);
+			return;
+		}
+		modes.push_back(rank);
+	}
+	if (modes.empty())
+		modes.push_back(3);
+
+	for (int mode : modes) {
+		if (mode < 0 || mode > 28) {
+			vsapi->mapSetError(out, "RemoveGrain: mode must be between 0 and 28");
+			vsapi->freeNode(d->node);
+			return;
+		}
+	}
+	d->mode = modes[0];
+
+	d->opt = vsapi->mapGetIntSaturated(in, "opt", 0, &err);
 	if (err)
-		d->mode = 3;
+		d->opt = 0;
+
+	if (d->opt < 0 || d->opt > 5) {
+		vsapi->mapSetError(out, "RemoveGrain: opt must be between 0 and 5");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const int cpu_opt = get_cpu_opt();
+	if (d->opt > cpu_opt) {
+		vsapi->mapSetError(out, "RemoveGrain: opt is not supported by this CPU");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const int opt = d->opt ? d->opt : cpu_opt;
+
+	d->border = vsapi->mapGetIntSaturated(in, "border", 0, &err);
+	if (err)
+		d->border = 0;
+
+	if (d->border < 0 || d->border > 2) {
+		vsapi->mapSetError(out, "RemoveGrain: border must be 0 (copy), 1 (repeat) or 2 (mirror)");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	// intra-frame parallelism for one frame at a time, 0: as many threads as the hardware has
+	d->threads = vsapi->mapGetIntSaturated(in, "threads", 0, &err);
+	if (err)
+		d->threads = 1;
+
+	if (d->threads < 0) {
+		vsapi->mapSetError(out, "RemoveGrain: threads must be 0 (auto) or positive");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	// The bands of every instance of a core share its pool, one worker per hardware thread besides the
+	// calling one. It is meant for few frames in flight, like a preview asking for one frame at a time,
+	// where the frame threads of the core are idle. An explicit threads is used as given.
+	VSCoreInfo core_info;
+	vsapi->getCoreInfo(core, &core_info);
+	const int core_threads = std::max(core_info.numThreads, 1);
+	const int hardware_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+	// A frame thread waits in ThreadPool::run until the bands of its plane are done. With more frame
+	// threads than bands the core can keep the hardware busy with whole frames, so auto does not split
+	// then. The frame threads say nothing about the frames actually in flight, an explicit threads is
+	// left to the user.
+	if (!d->threads)
+		d->threads = core_threads > 2 * hardware_threads ? 1 : hardware_threads;
+	if (d->threads > 1)
+		d->pool = ThreadPool::acquire(core, std::max(hardware_threads - 1, 1));
 
 	int bits_per_pixel = d->vi->format.bitsPerSample;
-	int pixelsize = d->vi->format.bytesPerSample;
+	d->pixel_max = d->vi->format.sampleType == stInteger && bits_per_pixel <= 16 ? (1 << bits_per_pixel) - 1 : 0;
+
+	const bool aligned = has_aligned_widths(d->vi, opt);
+
+	// non-temporal stores for the output, -1: only when the luma plane is larger than stream_threshold
+	int stream = vsapi->mapGetIntSaturated(in, "stream", 0, &err);
+	if (err)
+		stream = -1;
 
-	if (pixelsize == 1) {
-		d->functions = c_functions;
+	if (stream < -1 || stream > 1) {
+		vsapi->mapSetError(out, "RemoveGrain: stream must be -1 (auto), 0 or 1");
+		vsapi->freeNode(d->node);
+		return;
 	}
-	else if (pixelsize == 2) {
-		switch (bits_per_pixel) {
-		case 10: d->functions = c_functions_10; break;
-		case 12: d->functions = c_functions_12; break;
-		case 14: d->functions = c_functions_14; break;
-		case 16: d->functions = c_functions_16; break;
+
+	if (stream == -1)
+		stream = vsh::isConstantVideoFormat(d->vi) &&
+			static_cast<int64_t>(d->vi->width) * d->vi->height * d->vi->format.bytesPerSample > stream_threshold;
+	// they need the aligned row loops
+	const bool streaming = aligned && stream;
+
+	if (d->vi->format.sampleType == stFloat && bits_per_pixel == 16) {
+		d->functions = select_half_functions(opt, false, aligned, streaming);
+		d->functions_chroma = select_half_functions(opt, true, aligned, streaming);
+		if (!d->functions) {
+			vsapi->mapSetError(out, "RemoveGrain: 16 bit float input needs AVX2 (F16C), opt must be 0, 4 or 5");
+			vsapi->freeNode(d->node);
+			return;
 		}
 	}
 	else {
-		d->functions = c_functions_32_luma;
-		d->functions_chroma = c_functions_32_chroma;
+		d->functions = select_functions(opt, bits_per_pixel, false, aligned, streaming);
+		if (d->vi->format.sampleType == stFloat)
+			d->functions_chroma = select_functions(opt, bits_per_pixel, true, aligned, streaming);
+		if (!d->functions) {
+			vsapi->mapSetError(out, "RemoveGrain: only 8-16 bit integer and 16, 32 bit float input supported");
+			vsapi->freeNode(d->node);
+			return;
+		}
+	}
+
+	// AviSynth SSE2 rounding, float has no rounding to reproduce
+	const bool exact = !!vsapi->mapGetInt(in, "exact", 0, &err);
+	if (exact && d->vi->format.sampleType == stInteger)
+		d->exact_function = select_exact_function(opt, bits_per_pixel, d->mode);
+
+	// Every stage but the last writes the rolling buffer, which is read right back and must not be streamed.
+	if (modes.size() > 1) {
+		// the edges of every mode would have to be redone from the padded result of the previous one
+		if (d->border) {
+			vsapi->mapSetError(out, "RemoveGrain: a list of modes needs border=0");
+			vsapi->freeNode(d->node);
+			return;
+		}
+
+		PlaneProcessor** functions = d->functions;
+		PlaneProcessor** functions_chroma = d->functions_chroma;
+		if (streaming) {
+			const bool half = d->vi->format.sampleType == stFloat && bits_per_pixel == 16;
+			functions = half ? select_half_functions(opt, false, aligned, false) : select_functions(opt, bits_per_pixel, false, aligned, false);
+			if (d->vi->format.sampleType == stFloat)
+				functions_chroma = half ? select_half_functions(opt, true, aligned, false) : select_functions(opt, bits_per_pixel, true, aligned, false);
+		}
+
+		for (size_t i = 0; i < modes.size(); i++) {
+			const bool last = i == modes.size() - 1;
+			PlaneProcessor* exact_function = exact && d->vi->format.sampleType == stInteger ? select_exact_function(opt, bits_per_pixel, modes[i]) : nullptr;
+			d->chain.push_back(exact_function ? exact_function : (last ? d->functions : functions)[modes[i]]);
+			if (d->vi->format.sampleType == stFloat)
+				d->chain_chroma.push_back((last ? d->functions_chroma : functions_chroma)[modes[i]]);
+		}
 	}
 
+	// Mode lists keep their chunks in cache anyway.
+	d->tiled = d->chain.empty();
+
+	// Subsampled U and V share their size and processor, so their rows are processed side by side.
+	// Streaming stores would bypass the cache the staged chunks are copied through.
+	d->interleave_chroma = vsh::isConstantVideoFormat(d->vi) &&
+		d->vi->format.colorFamily == cfYUV && d->vi->format.numPlanes == 3 &&
+		(d->vi->format.subSamplingW || d->vi->format.subSamplingH) &&
+		d->mode && !streaming && d->chain.empty() &&
+		(d->mode < 13 || d->mode > 16);
+
+	// The planes are tasks of their own once threads covers all of them, with fewer threads each plane
+	// is split into bands on its own.
+	d->parallel_planes = d->pool && d->threads >= (d->interleave_chroma ? 2 : d->vi->format.numPlanes);
+
+	static const char* const opt_names[] = { "C", "SSE2", "SSE4.1", "AVX2", "AVX-512" };
+	const std::string path = std::string("RemoveGrain: ") + opt_names[opt - 1] +
+		(d->chain.empty() ? "" : ", " + std::to_string(d->chain.size()) + " modes in one pass") +
+		(opt == 1 ? "" : aligned ? ", aligned rows" : ", unaligned rows") +
+		(streaming ? ", streaming stores" : "") +
+		(d->interleave_chroma ? ", interleaved chroma" : "") +
+		(d->threads > 1 ? ", " + std::to_string(d->threads) + " threads" : "") +
+		(d->tiled && static_cast<int64_t>(d->vi->width) * d->vi->format.bytesPerSample > 2 * strip_row_bytes ? ", cache strips" : "");
+	vsapi->logMessage(mtDebug, path.c_str(), core);
 
 	VSFilterDependency deps[] = { {d->node, rpStrictSpatial} };
 	vsapi->createVideoFilter(out, "RemoveGrain", d->vi, rgToolsGetFrame, rgToolsFree, fmParallel, deps, 1, d.get(), core);
 	d.release();
-}
\ No newline at end of file
+}
+
+// RemoveGrainMulti: an internal node renders the frame of every mode from one pass over the source into
+// one frame, the modes stacked top to bottom. Every output node copies its mode out of that frame. The
+// core caches the stacked frames like any other, within its memory limit, and the outputs asking for
+// the same frame get it from there instead of running the modes again.
+static const VSFrame* VS_CC rgToolsMultiGetFrame(int n, int activationReason, void* instanceData, void** frameData, VSFrameContext* frameCtx, VSCore* core, const VSAPI* vsapi) {
+	auto d{ static_cast<RgToolsMultiData*>(instanceData) };
+
+	if (activationReason == arInitial) {
+		vsapi->requestFrameFilter(n, d->node, frameCtx);
+	}
+	else if (activationReason == arAllFramesReady) {
+		const VSFrame* src = vsapi->getFrameFilter(n, d->node, frameCtx);
+		const VSVideoFormat* fi = vsapi->getVideoFrameFormat(src);
+		VSFrame* dst = vsapi->newVideoFrame(fi, d->vi.width, d->vi.height, src, core);
+
+		const int count = static_cast<int>(d->modes.size());
+		std::vector<uint8_t*> dstp(count);
+		std::vector<ptrdiff_t> dst_pitch(count);
+		for (int plane{ 0 }; plane < fi->numPlanes; plane++) {
+			const int height = vsapi->getFrameHeight(src, plane);
+			const ptrdiff_t pitch = vsapi->getStride(dst, plane);
+			uint8_t* pStacked = vsapi->getWritePtr(dst, plane);
+			for (int i = 0; i < count; i++) {
+				dstp[i] = pStacked + i * height * pitch;
+				dst_pitch[i] = pitch;
+			}
+			const bool chroma = plane && fi->colorFamily != cfRGB && fi->sampleType == stFloat;
+			process_plane_multi(chroma ? d->functions_chroma.data() : d->functions.data(), count, fi->bytesPerSample,
+				vsapi->getReadPtr(src, plane), dstp.data(), dst_pitch.data(),
+				vsapi->getFrameWidth(src, plane), height, vsapi->getStride(src, plane), d->pixel_max);
+		}
+
+		vsapi->freeFrame(src);
+		return dst;
+	}
+	return nullptr;
+}
+
+static void VS_CC rgToolsMultiFree(void* instanceData, VSCore* core, const VSAPI* vsapi) {
+	auto d{ static_cast<RgToolsMultiData*>(instanceData) };
+	vsapi->freeNode(d->node);
+	delete d;
+}
+
+static const VSFrame* VS_CC rgToolsMultiOutputGetFrame(int n, int activationReason, void* instanceData, void** frameData, VSFrameContext* frameCtx, VSCore* core, const VSAPI* vsapi) {
+	auto output{ static_cast<RgToolsMultiOutput*>(instanceData) };
+
+	if (activationReason == arInitial) {
+		vsapi->requestFrameFilter(n, output->node, frameCtx);
+	}
+	else if (activationReason == arAllFramesReady) {
+		const VSFrame* stacked = vsapi->getFrameFilter(n, output->node, frameCtx);
+		const VSVideoFormat* fi = vsapi->getVideoFrameFormat(stacked);
+		VSFrame* dst = vsapi->newVideoFrame(fi, output->vi->width, output->vi->height, stacked, core);
+
+		for (int plane{ 0 }; plane < fi->numPlanes; plane++) {
+			const int height = vsapi->getFrameHeight(dst, plane);
+			const ptrdiff_t pitch = vsapi->getStride(stacked, plane);
+			vsh::bitblt(vsapi->getWritePtr(dst, plane), vsapi->getStride(dst, plane),
+				vsapi->getReadPtr(stacked, plane) + output->index * height * pitch, pitch,
+				vsapi->getFrameWidth(dst, plane) * fi->bytesPerSample, height);
+		}
+
+		vsapi->freeFrame(stacked);
+		return dst;
+	}
+	return nullptr;
+}
+
+static void VS_CC rgToolsMultiOutputFree(void* instanceData, VSCore* core, const VSAPI* vsapi) {
+	auto output{ static_cast<RgToolsMultiOutput*>(instanceData) };
+	vsapi->freeNode(output->node);
+	delete output;
+}
+
+void VS_CC rgToolsMultiCreate(const VSMap* in, VSMap* out, void* userData, VSCore* core, const VSAPI* vsapi) {
+	auto d{ std::make_unique<RgToolsMultiData>() };
+	int err = 0;
+
+	d->node = vsapi->mapGetNode(in, "clip", 0, nullptr);
+	const VSVideoInfo* vi = vsapi->getVideoInfo(d->node);
+
+	// the stacked frame needs the size of every frame up front
+	if (!vsh::isConstantVideoFormat(vi)) {
+		vsapi->mapSetError(out, "RemoveGrainMulti: only constant format input supported");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const int num_modes = vsapi->mapNumElements(in, "modes");
+	for (int i = 0; i < num_modes; i++) {
+		const int mode = vsapi->mapGetIntSaturated(in, "modes", i, nullptr);
+		if (mode < 0 || mode > 28) {
+			vsapi->mapSetError(out, "RemoveGrainMulti: modes must be between 0 and 28");
+			vsapi->freeNode(d->node);
+			return;
+		}
+		d->modes.push_back(mode);
+	}
+
+	if (d->modes.empty()) {
+		vsapi->mapSetError(out, "RemoveGrainMulti: modes must not be empty");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	d->opt = vsapi->mapGetIntSaturated(in, "opt", 0, &err);
+	if (err)
+		d->opt = 0;
+
+	if (d->opt < 0 || d->opt > 5) {
+		vsapi->mapSetError(out, "RemoveGrainMulti: opt must be between 0 and 5");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const int cpu_opt = get_cpu_opt();
+	if (d->opt > cpu_opt) {
+		vsapi->mapSetError(out, "RemoveGrainMulti: opt is not supported by this CPU");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const int opt = d->opt ? d->opt : cpu_opt;
+	const int bits_per_pixel = vi->format.bitsPerSample;
+	const bool is_float = vi->format.sampleType == stFloat;
+	d->pixel_max = !is_float && bits_per_pixel <= 16 ? (1 << bits_per_pixel) - 1 : 0;
+
+	// the stacked frame comes from the core, the aligned tables fit whenever the widths do
+	const bool aligned = has_aligned_widths(vi, opt);
+	const bool half = is_float && bits_per_pixel == 16;
+	PlaneProcessor** functions = half ? select_half_functions(opt, false, aligned, false) : select_functions(opt, bits_per_pixel, false, aligned, false);
+	PlaneProcessor** functions_chroma = !is_float ? nullptr : half ? select_half_functions(opt, true, aligned, false) : select_functions(opt, bits_per_pixel, true, aligned, false);
+	if (!functions) {
+		vsapi->mapSetError(out, half ? "RemoveGrainMulti: 16 bit float input needs AVX2 (F16C), opt must be 0, 4 or 5" :
+			"RemoveGrainMulti: only 8-16 bit integer and 16, 32 bit float input supported");
+		vsapi->freeNode(d->node);
+		return;
+	}
+
+	const bool exact = !!vsapi->mapGetInt(in, "exact", 0, &err);
+	for (int mode : d->modes) {
+		PlaneProcessor* exact_function = exact && !is_float ? select_exact_function(opt, bits_per_pixel, mode) : nullptr;
+		d->functions.push_back(exact_function ? exact_function : functions[mode]);
+		if (is_float)
+			d->functions_chroma.push_back(functions_chroma[mode]);
+	}
+
+	const int count = static_cast<int>(d->modes.size());
+	d->vi = *vi;
+	d->vi.height *= count;
+
+	VSFilterDependency deps[] = { {d->node, rpStrictSpatial} };
+	VSNode* stacked = vsapi->createVideoFilter2("RemoveGrainMulti", &d->vi, rgToolsMultiGetFrame, rgToolsMultiFree, fmParallel, deps, 1, d.get(), core);
+	d.release();
+
+	for (int i = 0; i < count; i++) {
+		VSFilterDependency output_deps[] = { {stacked, rpStrictSpatial} };
+		vsapi->createVideoFilter(out, "RemoveGrainMulti", vi, rgToolsMultiOutputGetFrame, rgToolsMultiOutputFree, fmParallel, output_deps, 1, new RgToolsMultiOutput{ vsapi->addNodeRef(stacked), vi, i }, core);
+	}
+	vsapi->freeNode(stacked);
+}
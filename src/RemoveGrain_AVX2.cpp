@@ -1 +1,31 @@
-//#include "common.h"
\ No newline at end of file
+// own namespace, inline vector class members must not be shared between instruction sets
+#define VCL_NAMESPACE rg_avx2
+#include "rg_functions_simd.h"
+
+PlaneProcessor** avx2_functions(int bits_per_pixel, bool chroma, bool aligned, bool stream) {
+	return simd_functions<Vec32uc, Vec16us, Vec8f>(bits_per_pixel, chroma, aligned, stream);
+}
+
+PlaneProcessor** avx2_half_functions(bool chroma, bool aligned, bool stream) {
+	return simd_half_functions<Vec8f>(chroma, aligned, stream);
+}
+
+PlaneProcessor* avx2_exact_function(int bits_per_pixel, int mode) {
+	return simd_exact_function<Vec32uc, Vec16us>(bits_per_pixel, mode);
+}
+
+ConvPlaneProcessor* avx2_convolution(int bits_per_pixel) {
+	return simd_convolution<Vec32uc, Vec16us, Vec8f>(bits_per_pixel);
+}
+
+CustomPlaneProcessor* avx2_custom(int bits_per_pixel) {
+	return simd_custom<Vec32uc, Vec16us, Vec8f>(bits_per_pixel);
+}
+
+PlaneProcessor* avx2_minblur(int bits_per_pixel) {
+	return simd_minblur<Vec32uc, Vec16us, Vec8f>(bits_per_pixel);
+}
+
+PlaneProcessor* avx2_half_minblur() {
+	return simd_half_minblur<Vec8f>();
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+// own namespace, inline vector class members must not be shared between instruction sets
+#define VCL_NAMESPACE rg_avx512
+#include "rg_functions_simd.h"
+
+PlaneProcessor** avx512_functions(int bits_per_pixel, bool chroma, bool aligned, bool stream) {
+	return simd_functions<Vec64uc, Vec32us, Vec16f>(bits_per_pixel, chroma, aligned, stream);
+}
+
+PlaneProcessor** avx512_half_functions(bool chroma, bool aligned, bool stream) {
+	return simd_half_functions<Vec16f>(chroma, aligned, stream);
+}
+
+PlaneProcessor* avx512_exact_function(int bits_per_pixel, int mode) {
+	return simd_exact_function<Vec64uc, Vec32us>(bits_per_pixel, mode);
+}
+
+ConvPlaneProcessor* avx512_convolution(int bits_per_pixel) {
+	return simd_convolution<Vec64uc, Vec32us, Vec16f>(bits_per_pixel);
+}
+
+CustomPlaneProcessor* avx512_custom(int bits_per_pixel) {
+	return simd_custom<Vec64uc, Vec32us, Vec16f>(bits_per_pixel);
+}
+
+PlaneProcessor* avx512_minblur(int bits_per_pixel) {
+	return simd_minblur<Vec64uc, Vec32us, Vec16f>(bits_per_pixel);
+}
+
+PlaneProcessor* avx512_half_minblur() {
+	return simd_half_minblur<Vec16f>();
+}
\ No newline at end of file
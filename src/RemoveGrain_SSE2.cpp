@@ -0,0 +1,23 @@
+// own namespace, inline vector class members must not be shared between instruction sets
+#define VCL_NAMESPACE rg_sse2
+#include "rg_functions_simd.h"
+
+PlaneProcessor** sse2_functions(int bits_per_pixel, bool chroma, bool aligned, bool stream) {
+	return simd_functions<Vec16uc, Vec8us, Vec4f>(bits_per_pixel, chroma, aligned, stream);
+}
+
+PlaneProcessor* sse2_exact_function(int bits_per_pixel, int mode) {
+	return simd_exact_function<Vec16uc, Vec8us>(bits_per_pixel, mode);
+}
+
+ConvPlaneProcessor* sse2_convolution(int bits_per_pixel) {
+	return simd_convolution<Vec16uc, Vec8us, Vec4f>(bits_per_pixel);
+}
+
+CustomPlaneProcessor* sse2_custom(int bits_per_pixel) {
+	return simd_custom<Vec16uc, Vec8us, Vec4f>(bits_per_pixel);
+}
+
+PlaneProcessor* sse2_minblur(int bits_per_pixel) {
+	return simd_minblur<Vec16uc, Vec8us, Vec4f>(bits_per_pixel);
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "common.h"
+
+// The tasks of one run call, the caller waits until none is left.
+struct ThreadPool::Batch final {
+	const std::function<void(int)>& job;
+	int remaining; // under mutex
+	std::mutex mutex;
+	std::condition_variable done;
+
+	Batch(const std::function<void(int)>& batch_job, int count) : job(batch_job), remaining(count) {}
+};
+
+struct ThreadPool::Task final {
+	Batch* batch;
+	int index;
+};
+
+struct ThreadPool::Queue final {
+	std::mutex mutex;
+	std::deque<Task> tasks;
+};
+
+std::shared_ptr<ThreadPool> ThreadPool::acquire(const VSCore* core, int workers) {
+	static std::mutex lock;
+	static std::map<const VSCore*, std::weak_ptr<ThreadPool>> shared;
+
+	std::lock_guard<std::mutex> guard(lock);
+	// pools of freed cores are gone already, their entries go before a new core can get the same address
+	for (auto it = shared.begin(); it != shared.end();)
+		it = it->second.expired() ? shared.erase(it) : std::next(it);
+
+	std::weak_ptr<ThreadPool>& entry = shared[core];
+	std::shared_ptr<ThreadPool> pool = entry.lock();
+	if (!pool) {
+		pool = std::make_shared<ThreadPool>(workers);
+		entry = pool;
+	}
+	return pool;
+}
+
+ThreadPool::ThreadPool(int num_workers) {
+	for (int i = 0; i < num_workers; ++i)
+		queues.emplace_back(new Queue);
+	for (int i = 0; i < num_workers; ++i)
+		workers.emplace_back(&ThreadPool::worker, this, i);
+}
+
+// joined from the free function of the last filter, never from a worker or while the plugin is unloaded
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		stop = true;
+	}
+	wake.notify_all();
+	for (auto& thread : workers)
+		thread.join();
+}
+
+// newest task of the own deque, else the oldest one of the next deque that has any, self -1: not a worker
+bool ThreadPool::take(int self, Task& task) {
+	const int count = static_cast<int>(queues.size());
+	if (self >= 0) {
+		Queue& own = *queues[self];
+		std::lock_guard<std::mutex> guard(own.mutex);
+		if (!own.tasks.empty()) {
+			task = own.tasks.back();
+			own.tasks.pop_back();
+			--pending;
+			return true;
+		}
+	}
+	const int start = self >= 0 ? self + 1 : static_cast<int>(next_queue % count);
+	for (int i = 0; i < count; ++i) {
+		Queue& victim = *queues[(start + i) % count];
+		std::lock_guard<std::mutex> guard(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			--pending;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::execute(const Task& task) {
+	Batch& batch = *task.batch;
+	batch.job(task.index);
+	// the batch lives on the stack of run, it is not touched once the lock is released
+	std::lock_guard<std::mutex> guard(batch.mutex);
+	if (--batch.remaining == 0)
+		batch.done.notify_one();
+}
+
+void ThreadPool::worker(int self) {
+	for (;;) {
+		Task task;
+		if (take(self, task)) {
+			execute(task);
+			continue;
+		}
+		std::unique_lock<std::mutex> guard(mutex);
+		wake.wait(guard, [this] { return stop || pending > 0; });
+		if (stop)
+			return;
+	}
+}
+
+void ThreadPool::run(int count, const std::function<void(int)>& job) {
+	if (count <= 1) {
+		if (count == 1)
+			job(0);
+		return;
+	}
+
+	Batch batch(job, count);
+	const unsigned first = next_queue.fetch_add(static_cast<unsigned>(count));
+	for (int i = 0; i < count; ++i) {
+		Queue& queue = *queues[(first + i) % queues.size()];
+		std::lock_guard<std::mutex> guard(queue.mutex);
+		queue.tasks.push_back({ &batch, i });
+	}
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		pending += count;
+	}
+	wake.notify_all();
+
+	// help out, with tasks of other batches as well, until nothing is queued
+	Task task;
+	while (take(-1, task))
+		execute(task);
+
+	std::unique_lock<std::mutex> guard(batch.mutex);
+	batch.done.wait(guard, [&batch] { return batch.remaining == 0; });
+}
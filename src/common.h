@@ -1,24 +1,199 @@
 #pragma once
 
 #include <memory>
+#include <cstring>
 #include <algorithm>
+#include <atomic>
+#include <type_traits>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
 
 #include "VCL2/vectorclass.h"
 #include "VapourSynth4.h"
 #include "VSHelper4.h"
 
+// Convolution3x3 rounds every product on its own in the C and the vector passes, so they give the
+// same result. Contracting a * b + c into an FMA would break that: MSVC only does it with /fp:contract,
+// clang and GCC are told off below.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
 
-typedef void (PlaneProcessor)(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch);
+
+// pixel_max: (1 << bits) - 1 of integer clips, only the saturating 9-16 bit kernels read it
+typedef void (PlaneProcessor)(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max);
+
+// Work-stealing pool owned by the plugin for splitting frames over several cores. One pool per core is
+// shared by its filter instances with threads > 1, created by the first and stopped when the last is freed.
+// Every worker has its own deque of tasks, takes its newest task first and steals the oldest task of
+// another worker when its own deque is empty. Threads waiting in run take part the same way.
+class ThreadPool final {
+public:
+	// the pool of the core, a new one gets workers threads
+	static std::shared_ptr<ThreadPool> acquire(const VSCore* core, int workers);
+	explicit ThreadPool(int num_workers);
+	~ThreadPool();
+
+	// runs job(0) .. job(count - 1) as tasks on the pool and returns when all are done
+	void run(int count, const std::function<void(int)>& job);
+
+private:
+	struct Batch;
+	struct Task;
+	struct Queue;
+
+	std::vector<std::unique_ptr<Queue>> queues; // one per worker, fixed once the workers run
+	std::vector<std::thread> workers;
+	std::atomic<unsigned> next_queue{ 0 }; // round robin for the tasks of run
+	std::atomic<int> pending{ 0 }; // queued tasks, workers sleep while there are none
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stop = false; // under mutex
+
+	bool take(int self, Task& task);
+	void execute(const Task& task);
+	void worker(int self);
+};
 
 struct RgToolsData final {
 	VSNode* node;
 	const VSVideoInfo* vi;
 	int mode;
+	int opt; // 0: auto, 1: C, 2: SSE2, 3: SSE4.1, 4: AVX2, 5: AVX-512
+	int border; // 0: copy, 1: repeat, 2: mirror
+	int pixel_max; // integer formats only
+	bool interleave_chroma; // U and V staged side by side, see process_planes_staged
 	PlaneProcessor** functions;
 	PlaneProcessor** functions_chroma; // only for float
+	PlaneProcessor* exact_function; // exact=True kernel for the mode, nullptr when the table entry is used
+	std::vector<PlaneProcessor*> chain; // one processor per mode of a mode list, empty for a single mode
+	std::vector<PlaneProcessor*> chain_chroma; // only for float
+	bool tiled; // wide rows in vertical strips, see process_plane_strips
+	int threads; // bands of a plane processed at once, 1: on the calling thread only
+	std::shared_ptr<ThreadPool> pool; // threads > 1 only
+	bool parallel_planes; // planes as tasks on the pool, see rgToolsGetFrame
+};
+
+// RemoveGrainMulti, the internal node rendering every mode into one frame, see rgToolsMultiCreate
+struct RgToolsMultiData final {
+	VSNode* node;
+	VSVideoInfo vi; // of the stacked frame, the source with height times the number of modes
+	int opt; // 0: auto, 1: C, 2: SSE2, 3: SSE4.1, 4: AVX2, 5: AVX-512
+	int pixel_max; // integer formats only
+	std::vector<int> modes;
+	std::vector<PlaneProcessor*> functions; // one per mode
+	std::vector<PlaneProcessor*> functions_chroma; // only for float
+};
+
+// RemoveGrainMulti, one output node per mode
+struct RgToolsMultiOutput final {
+	VSNode* node; // the stacked node
+	const VSVideoInfo* vi; // of the source
+	int index; // into modes
+};
+
+// A 3x3 kernel as a sum of separable terms, each a row filter followed by a column filter.
+// The running-sum engine keeps the row filtered sums of every term for three source rows.
+struct ConvParams final {
+	int terms = 1;
+	float horizontal[3][3] = {};
+	float vertical[3][3] = {};
+	float divisor = 1.0f;
+	float pixel_max = 0.0f; // integer formats only, float is not clamped
+};
+
+typedef void (ConvPlaneProcessor)(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, const ConvParams& params);
+
+// Custom: an expression over the 3x3 square compiled to a register program. Registers 0-8 hold
+// a1 a2 a3 a4 c a5 a6 a7 a8, the constants follow, then one register per instruction.
+enum class CustomOp : uint8_t { min, max, clip, avg, absdiff, adds, subs };
+
+struct CustomInstr final {
+	CustomOp op;
+	uint8_t dst;
+	uint8_t src[3]; // clip: value, minimum, maximum
+};
+
+struct CustomProgram final {
+	static constexpr int square_registers = 9;
+	static constexpr int max_registers = 64;
+	int num_constants = 0;
+	float constants[max_registers] = {};
+	int num_instructions = 0;
+	CustomInstr code[max_registers] = {};
+	int result = 4; // register of the output pixel, c for an empty program
+	int pixel_max = 0; // integer formats only, adds saturates there
+};
+
+typedef void (CustomPlaneProcessor)(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, const CustomProgram& program);
+
+struct Convolution3x3Data final {
+	VSNode* node;
+	const VSVideoInfo* vi;
+	int opt; // 0: auto, 1: C, 2: SSE2, 3: SSE4.1, 4: AVX2, 5: AVX-512
+	ConvParams params;
+	ConvPlaneProcessor* function;
+};
+
+struct CustomData final {
+	VSNode* node;
+	const VSVideoInfo* vi;
+	int opt; // 0: auto, 1: C, 2: SSE2, 3: SSE4.1, 4: AVX2, 5: AVX-512
+	CustomProgram program;
+	CustomPlaneProcessor* function;
+};
+
+struct MinBlurData final {
+	VSNode* node;
+	const VSVideoInfo* vi;
+	int opt; // 0: auto, 1: C, 2: SSE2, 3: SSE4.1, 4: AVX2, 5: AVX-512
+	int pixel_max;
+	bool process[3];
+	PlaneProcessor* function;
 };
 
 extern void VS_CC rgToolsCreate(const VSMap* in, VSMap* out, void* userData, VSCore* core, const VSAPI* vsapi);
+extern void VS_CC rgToolsMultiCreate(const VSMap* in, VSMap* out, void* userData, VSCore* core, const VSAPI* vsapi);
+extern void VS_CC convolution3x3Create(const VSMap* in, VSMap* out, void* userData, VSCore* core, const VSAPI* vsapi);
+extern void VS_CC customCreate(const VSMap* in, VSMap* out, void* userData, VSCore* core, const VSAPI* vsapi);
+extern void VS_CC minBlurCreate(const VSMap* in, VSMap* out, void* userData, VSCore* core, const VSAPI* vsapi);
+
+// highest opt value the CPU can run
+extern int get_cpu_opt();
+
+// per instruction set tables, nullptr when there is none for the format
+extern PlaneProcessor** sse2_functions(int bits_per_pixel, bool chroma, bool aligned, bool stream);
+extern PlaneProcessor** sse4_functions(int bits_per_pixel, bool chroma, bool aligned, bool stream);
+extern PlaneProcessor** avx2_functions(int bits_per_pixel, bool chroma, bool aligned, bool stream);
+extern PlaneProcessor** avx512_functions(int bits_per_pixel, bool chroma, bool aligned, bool stream);
+// fp16 tables, F16C comes with AVX2
+extern PlaneProcessor** avx2_half_functions(bool chroma, bool aligned, bool stream);
+extern PlaneProcessor** avx512_half_functions(bool chroma, bool aligned, bool stream);
+extern PlaneProcessor* sse2_exact_function(int bits_per_pixel, int mode);
+extern PlaneProcessor* sse4_exact_function(int bits_per_pixel, int mode);
+extern PlaneProcessor* avx2_exact_function(int bits_per_pixel, int mode);
+extern PlaneProcessor* avx512_exact_function(int bits_per_pixel, int mode);
+extern ConvPlaneProcessor* sse2_convolution(int bits_per_pixel);
+extern ConvPlaneProcessor* sse4_convolution(int bits_per_pixel);
+extern ConvPlaneProcessor* avx2_convolution(int bits_per_pixel);
+extern ConvPlaneProcessor* avx512_convolution(int bits_per_pixel);
+extern CustomPlaneProcessor* sse2_custom(int bits_per_pixel);
+extern CustomPlaneProcessor* sse4_custom(int bits_per_pixel);
+extern CustomPlaneProcessor* avx2_custom(int bits_per_pixel);
+extern CustomPlaneProcessor* avx512_custom(int bits_per_pixel);
+extern PlaneProcessor* sse2_minblur(int bits_per_pixel);
+extern PlaneProcessor* sse4_minblur(int bits_per_pixel);
+extern PlaneProcessor* avx2_minblur(int bits_per_pixel);
+extern PlaneProcessor* avx512_minblur(int bits_per_pixel);
+extern PlaneProcessor* avx2_half_minblur();
+extern PlaneProcessor* avx512_half_minblur();
 
 #if defined(__clang__)
 // Check clang first. clang-cl also defines __MSC_VER
@@ -61,6 +236,11 @@ extern void VS_CC rgToolsCreate(const VSMap* in, VSMap* out, void* userData, VSC
 #define LOAD_SQUARE_CPP_16(ptr, pitch) LOAD_SQUARE_CPP_0(uint16_t, ptr, pitch);
 #define LOAD_SQUARE_CPP_32(ptr, pitch) LOAD_SQUARE_CPP_0(float, ptr, pitch);
 
+template<typename pixel_t>
+static void copyPlane(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int) {
+	vsh::bitblt(pDst, dstPitch, pSrc, srcPitch, width * sizeof(pixel_t), height);
+}
+
 
 
 template<typename T>
@@ -102,9 +282,7 @@ static RG_FORCEINLINE int adds_c(int x, int y) {
     return std::min(pixel_max, x + y);
 }
 
-template<int bits_per_pixel>
-static RG_FORCEINLINE int adds_16_c(int x, int y) {
-    constexpr int pixel_max = (1 << bits_per_pixel) - 1;
+static RG_FORCEINLINE int adds_16_c(int x, int y, int pixel_max) {
     return std::min(pixel_max, x + y);
 }
 
@@ -119,15 +297,14 @@ static RG_FORCEINLINE float adds_32_c_for_diff(float x, float y) {
     return std::min(pixel_max, x + y);
 }
 
-template<int bits_per_pixel>
-static RG_FORCEINLINE int sharpen_c(const int& center, const int& minus, const int& plus) {
+static RG_FORCEINLINE int sharpen_c(const int& center, const int& minus, const int& plus, int pixel_max) {
     auto mp_diff = subs_16_c(minus, plus);
     auto pm_diff = subs_16_c(plus, minus);
     auto m_per2 = minus >> 1;
     auto p_per2 = plus >> 1;
     auto min_1 = std::min(p_per2, mp_diff);
     auto min_2 = std::min(m_per2, pm_diff);
-    return subs_16_c(adds_16_c<bits_per_pixel>(center, min_1), min_2);
+    return subs_16_c(adds_16_c(center, min_1, pixel_max), min_2);
 }
 
 template<bool chroma>
@@ -142,13 +319,12 @@ static RG_FORCEINLINE float sharpen_32_c(const float& center, const float& minus
 }
 
 // helper for mode 25
-template<int bits_per_pixel>
-static RG_FORCEINLINE void neighbourdiff_c(int& minus, int& plus, int center, int neighbour) {
+static RG_FORCEINLINE void neighbourdiff_c(int& minus, int& plus, int center, int neighbour, int pixel_max) {
     bool n_ge_c = center <= neighbour;
     bool c_ge_n = neighbour <= center;
     bool equ = center == neighbour;
 
-    constexpr int max_mask = (1 << bits_per_pixel) - 1;
+    const int max_mask = pixel_max;
     // an appropriately big number to use for testing max 
     // in sharpen
 
@@ -4,236 +4,135 @@
 #define __RG_FUNCTIONS_C_H__
 
 #include "common.h"
+#include "rg_modes.h"
 
 
 template<typename pixel_t>
 using CModeProcessor = pixel_t(*)(const uint8_t*, ptrdiff_t);
 
-RG_FORCEINLINE uint8_t rg_mode1_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    uint8_t mi = std::min(
-        std::min(std::min(a1, a2), std::min(a3, a4)),
-        std::min(std::min(a5, a6), std::min(a7, a8))
-    );
-    uint8_t ma = std::max(
-        std::max(std::max(a1, a2), std::max(a3, a4)),
-        std::max(std::max(a5, a6), std::max(a7, a8))
-    );
-
-    return clip(c, mi, ma);
+// The modes that saturate at the pixel maximum (6, 8, 23-25) take it as a third argument on 9-16 bit,
+// so one table serves every depth. The plane loops call their kernels through here,
+// M is int for the C kernels and the pixel vector for the SIMD ones.
+template<auto processor, typename M>
+static RG_FORCEINLINE auto call_processor(const uint8_t* ptr, ptrdiff_t pitch, const M& pixel_max) {
+    if constexpr (std::is_invocable_v<decltype(processor), const uint8_t*, ptrdiff_t, const M&>)
+        return processor(ptr, pitch, pixel_max);
+    else
+        return processor(ptr, pitch);
 }
 
-RG_FORCEINLINE uint16_t rg_mode1_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
+// ------------
 
-    uint16_t mi = std::min(
-        std::min(std::min(a1, a2), std::min(a3, a4)),
-        std::min(std::min(a5, a6), std::min(a7, a8))
-    );
-    uint16_t ma = std::max(
-        std::max(std::max(a1, a2), std::max(a3, a4)),
-        std::max(std::max(a5, a6), std::max(a7, a8))
-    );
+// Rank engine for modes 1-4: the center is clipped between the rank-th smallest and the rank-th largest
+// of the 8 neighbours. The neighbours are handled as sorted columns, left and right triples plus the
+// pixels above and below the center, so a row loop can sort each column once and reuse it.
 
-    return clip_16(c, mi, ma);
+template<typename T>
+static RG_FORCEINLINE void sort_pair_c(T& a, T& b) {
+    const T lo = std::min(a, b);
+    b = std::max(a, b);
+    a = lo;
 }
 
-RG_FORCEINLINE float rg_mode1_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
+template<typename T>
+static RG_FORCEINLINE void sort3_c(T& a, T& b, T& c) {
+    sort_pair_c(a, b);
+    sort_pair_c(b, c);
+    sort_pair_c(a, b);
+}
 
-    float mi = std::min(
-        std::min(std::min(a1, a2), std::min(a3, a4)),
-        std::min(std::min(a5, a6), std::min(a7, a8))
-    );
-    float ma = std::max(
-        std::max(std::max(a1, a2), std::max(a3, a4)),
-        std::max(std::max(a5, a6), std::max(a7, a8))
-    );
+// merges v into the sorted a0..a2, afterwards a0 <= a1 <= a2 <= v
+template<typename T>
+static RG_FORCEINLINE void insert3_c(T& a0, T& a1, T& a2, T& v) {
+    sort_pair_c(a0, v);
+    sort_pair_c(a2, v);
+    sort_pair_c(a1, a2);
+}
 
-    return clip_32(c, mi, ma);
+// Batcher merge of the sorted a0..a3 and b0..b3, afterwards a0 <= ... <= a3 <= b0 <= ... <= b3
+template<typename T>
+static RG_FORCEINLINE void merge4_c(T& a0, T& a1, T& a2, T& a3, T& b0, T& b1, T& b2, T& b3) {
+    sort_pair_c(a0, b0); sort_pair_c(a2, b2); sort_pair_c(a2, b0);
+    sort_pair_c(a1, b1); sort_pair_c(a3, b3); sort_pair_c(a3, b1);
+    sort_pair_c(a1, a2); sort_pair_c(a3, b0); sort_pair_c(b1, b2);
 }
 
-// ------------
+// l0..l2 and r0..r2 are sorted columns left and right of the center, top and bottom need no order.
+// Only the comparators leading to the two requested ranks survive inlining.
+template<int rank, typename T>
+static RG_FORCEINLINE void rank_select_c(T l0, T l1, T l2, T top, T bottom, T r0, T r1, T r2, T& lo, T& hi) {
+    insert3_c(l0, l1, l2, top);
+    insert3_c(r0, r1, r2, bottom);
+    merge4_c(l0, l1, l2, top, r0, r1, r2, bottom);
 
-RG_FORCEINLINE uint8_t rg_mode2_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
+    const T sorted[8] = { l0, l1, l2, top, r0, r1, r2, bottom };
+    lo = sorted[rank - 1];
+    hi = sorted[8 - rank];
+}
 
-    uint8_t a[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
+template<typename pixel_t, int rank>
+RG_FORCEINLINE pixel_t rg_rank_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_CPP_0(pixel_t, pSrc, srcPitch);
 
-    std::sort(&a[0], (&a[7]) + 1);
+    sort3_c(a1, a4, a6);
+    sort3_c(a3, a5, a8);
 
-    return clip(c, a[2 - 1], a[7 - 1]);
-}
+    pixel_t lo, hi;
+    rank_select_c<rank>(a1, a4, a6, a2, a7, a3, a5, a8, lo, hi);
 
-RG_FORCEINLINE uint16_t rg_mode2_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
+    return std::max(std::min(c, hi), lo);
+}
 
-    uint16_t a[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
+// ------------
 
-    std::sort(&a[0], (&a[7]) + 1);
+// C kernel of a mode from rg_modes.h, modes 1, 5, 9, 10, 13/14, 17, 18, 22 and 26-28
+template<typename pixel_t, typename mode>
+RG_FORCEINLINE pixel_t rg_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_CPP_0(pixel_t, pSrc, srcPitch);
 
-    return clip_16(c, a[2 - 1], a[7 - 1]);
+    return mode::apply(a1, a2, a3, a4, c, a5, a6, a7, a8);
 }
 
-RG_FORCEINLINE float rg_mode2_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
+// ------------
 
-    float a[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
+RG_FORCEINLINE uint8_t rg_mode2_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    return rg_rank_cpp<uint8_t, 2>(pSrc, srcPitch);
+}
 
-    std::sort(&a[0], (&a[7]) + 1);
+RG_FORCEINLINE uint16_t rg_mode2_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    return rg_rank_cpp<uint16_t, 2>(pSrc, srcPitch);
+}
 
-    return clip_32(c, a[2 - 1], a[7 - 1]);
+RG_FORCEINLINE float rg_mode2_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    return rg_rank_cpp<float, 2>(pSrc, srcPitch);
 }
 
 // ------------
 
 RG_FORCEINLINE uint8_t rg_mode3_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    uint8_t	a[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
-
-    std::sort(&a[0], (&a[7]) + 1);
-
-    return clip(c, a[3 - 1], a[6 - 1]);
+    return rg_rank_cpp<uint8_t, 3>(pSrc, srcPitch);
 }
 
 RG_FORCEINLINE uint16_t rg_mode3_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    uint16_t	a[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
-
-    std::sort(&a[0], (&a[7]) + 1);
-
-    return clip_16(c, a[3 - 1], a[6 - 1]);
+    return rg_rank_cpp<uint16_t, 3>(pSrc, srcPitch);
 }
 
 RG_FORCEINLINE float rg_mode3_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    float a[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
-
-    std::sort(&a[0], (&a[7]) + 1);
-
-    return clip_32(c, a[3 - 1], a[6 - 1]);
+    return rg_rank_cpp<float, 3>(pSrc, srcPitch);
 }
 
 // ------------
 
 RG_FORCEINLINE uint8_t rg_mode4_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    uint8_t a[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
-
-    std::sort(&a[0], (&a[7]) + 1);
-
-    return clip(c, a[4 - 1], a[5 - 1]);
+    return rg_rank_cpp<uint8_t, 4>(pSrc, srcPitch);
 }
 
 RG_FORCEINLINE uint16_t rg_mode4_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    uint16_t a[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
-
-    std::sort(&a[0], (&a[7]) + 1);
-
-    return clip_16(c, a[4 - 1], a[5 - 1]);
+    return rg_rank_cpp<uint16_t, 4>(pSrc, srcPitch);
 }
 
 RG_FORCEINLINE float rg_mode4_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    float	a[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
-
-    std::sort(&a[0], (&a[7]) + 1);
-
-    return clip_32(c, a[4 - 1], a[5 - 1]);
-}
-
-// ------------
-
-RG_FORCEINLINE uint8_t rg_mode5_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a2, a7);
-    auto mil2 = std::min(a2, a7);
-
-    auto mal3 = std::max(a3, a6);
-    auto mil3 = std::min(a3, a6);
-
-    auto mal4 = std::max(a4, a5);
-    auto mil4 = std::min(a4, a5);
-
-    uint8_t c1 = std::abs(c - clip(c, mil1, mal1));
-    uint8_t c2 = std::abs(c - clip(c, mil2, mal2));
-    uint8_t c3 = std::abs(c - clip(c, mil3, mal3));
-    uint8_t c4 = std::abs(c - clip(c, mil4, mal4));
-
-    auto mindiff = std::min(std::min(std::min(c1, c2), c3), c4);
-
-    if (mindiff == c4) return clip(c, mil4, mal4);
-    if (mindiff == c2) return clip(c, mil2, mal2);
-    if (mindiff == c3) return clip(c, mil3, mal3);
-    return clip(c, mil1, mal1);
-}
-
-RG_FORCEINLINE uint16_t rg_mode5_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a2, a7);
-    auto mil2 = std::min(a2, a7);
-
-    auto mal3 = std::max(a3, a6);
-    auto mil3 = std::min(a3, a6);
-
-    auto mal4 = std::max(a4, a5);
-    auto mil4 = std::min(a4, a5);
-
-    uint16_t c1 = std::abs(c - clip_16(c, mil1, mal1));
-    uint16_t c2 = std::abs(c - clip_16(c, mil2, mal2));
-    uint16_t c3 = std::abs(c - clip_16(c, mil3, mal3));
-    uint16_t c4 = std::abs(c - clip_16(c, mil4, mal4));
-
-    auto mindiff = std::min(std::min(std::min(c1, c2), c3), c4);
-
-    if (mindiff == c4) return clip_16(c, mil4, mal4);
-    if (mindiff == c2) return clip_16(c, mil2, mal2);
-    if (mindiff == c3) return clip_16(c, mil3, mal3);
-    return clip_16(c, mil1, mal1);
-}
-
-RG_FORCEINLINE float rg_mode5_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a2, a7);
-    auto mil2 = std::min(a2, a7);
-
-    auto mal3 = std::max(a3, a6);
-    auto mil3 = std::min(a3, a6);
-
-    auto mal4 = std::max(a4, a5);
-    auto mil4 = std::min(a4, a5);
-
-    float c1 = std::abs(c - clip_32(c, mil1, mal1));
-    float c2 = std::abs(c - clip_32(c, mil2, mal2));
-    float c3 = std::abs(c - clip_32(c, mil3, mal3));
-    float c4 = std::abs(c - clip_32(c, mil4, mal4));
-
-    auto mindiff = std::min(std::min(std::min(c1, c2), c3), c4);
-
-    if (mindiff == c4) return clip_32(c, mil4, mal4);
-    if (mindiff == c2) return clip_32(c, mil2, mal2);
-    if (mindiff == c3) return clip_32(c, mil3, mal3);
-    return clip_32(c, mil1, mal1);
+    return rg_rank_cpp<float, 4>(pSrc, srcPitch);
 }
 
 // ------------
@@ -276,8 +175,7 @@ RG_FORCEINLINE uint8_t rg_mode6_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
     return clip(c, mil1, mal1);
 }
 
-template<int bits_per_pixel>
-RG_FORCEINLINE uint16_t rg_mode6_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+RG_FORCEINLINE uint16_t rg_mode6_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch, int pixel_max) {
     LOAD_SQUARE_CPP_16(pSrc, srcPitch);
 
     auto mal1 = std::max(a1, a8);
@@ -302,10 +200,10 @@ RG_FORCEINLINE uint16_t rg_mode6_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch)
     uint16_t clipped3 = clip_16(c, mil3, mal3);
     uint16_t clipped4 = clip_16(c, mil4, mal4);
 
-    int c1 = adds_16_c<bits_per_pixel>(std::abs(c - clipped1) << 1, d1);
-    int c2 = adds_16_c<bits_per_pixel>(std::abs(c - clipped2) << 1, d2);
-    int c3 = adds_16_c<bits_per_pixel>(std::abs(c - clipped3) << 1, d3);
-    int c4 = adds_16_c<bits_per_pixel>(std::abs(c - clipped4) << 1, d4);
+    int c1 = adds_16_c(std::abs(c - clipped1) << 1, d1, pixel_max);
+    int c2 = adds_16_c(std::abs(c - clipped2) << 1, d2, pixel_max);
+    int c3 = adds_16_c(std::abs(c - clipped3) << 1, d3, pixel_max);
+    int c4 = adds_16_c(std::abs(c - clipped4) << 1, d4, pixel_max);
 
     int mindiff = std::min(std::min(std::min(c1, c2), c3), c4);
 
@@ -420,10 +318,10 @@ RG_FORCEINLINE uint16_t rg_mode7_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch)
     auto clipped3 = clip_16(c, mil3, mal3);
     auto clipped4 = clip_16(c, mil4, mal4);
 
-    int c1 = adds_16_c<16>(std::abs(c - clipped1), d1);
-    int c2 = adds_16_c<16>(std::abs(c - clipped2), d2);
-    int c3 = adds_16_c<16>(std::abs(c - clipped3), d3);
-    int c4 = adds_16_c<16>(std::abs(c - clipped4), d4);
+    int c1 = adds_16_c(std::abs(c - clipped1), d1, 65535);
+    int c2 = adds_16_c(std::abs(c - clipped2), d2, 65535);
+    int c3 = adds_16_c(std::abs(c - clipped3), d3, 65535);
+    int c4 = adds_16_c(std::abs(c - clipped4), d4, 65535);
 
     auto mindiff = std::min(std::min(std::min(c1, c2), c3), c4);
 
@@ -511,8 +409,7 @@ RG_FORCEINLINE uint8_t rg_mode8_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
     return clipped1;
 }
 
-template<int bits_per_pixel>
-RG_FORCEINLINE uint16_t rg_mode8_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+RG_FORCEINLINE uint16_t rg_mode8_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch, int pixel_max) {
     LOAD_SQUARE_CPP_16(pSrc, srcPitch);
 
     auto mal1 = std::max(a1, a8);
@@ -537,10 +434,10 @@ RG_FORCEINLINE uint16_t rg_mode8_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch)
     uint16_t clipped3 = clip_16(c, mil3, mal3);
     uint16_t clipped4 = clip_16(c, mil4, mal4);
 
-    int c1 = adds_16_c<bits_per_pixel>(std::abs(c - clipped1), d1 << 1);
-    int c2 = adds_16_c<bits_per_pixel>(std::abs(c - clipped2), d2 << 1);
-    int c3 = adds_16_c<bits_per_pixel>(std::abs(c - clipped3), d3 << 1);
-    int c4 = adds_16_c<bits_per_pixel>(std::abs(c - clipped4), d4 << 1);
+    int c1 = adds_16_c(std::abs(c - clipped1), d1 << 1, pixel_max);
+    int c2 = adds_16_c(std::abs(c - clipped2), d2 << 1, pixel_max);
+    int c3 = adds_16_c(std::abs(c - clipped3), d3 << 1, pixel_max);
+    int c4 = adds_16_c(std::abs(c - clipped4), d4 << 1, pixel_max);
 
     uint16_t mindiff = std::min(std::min(std::min(c1, c2), c3), c4);
 
@@ -591,184 +488,6 @@ RG_FORCEINLINE float rg_mode8_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
 
 // ------------
 
-RG_FORCEINLINE uint8_t rg_mode9_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a2, a7);
-    auto mil2 = std::min(a2, a7);
-
-    auto mal3 = std::max(a3, a6);
-    auto mil3 = std::min(a3, a6);
-
-    auto mal4 = std::max(a4, a5);
-    auto mil4 = std::min(a4, a5);
-
-    auto d1 = subs_c(mal1, mil1);
-    auto d2 = subs_c(mal2, mil2);
-    auto d3 = subs_c(mal3, mil3);
-    auto d4 = subs_c(mal4, mil4);
-
-    auto mindiff = std::min(std::min(std::min(d1, d2), d3), d4);
-
-    if (mindiff == d4) return clip(c, mil4, mal4);
-    if (mindiff == d2) return clip(c, mil2, mal2);
-    if (mindiff == d3) return clip(c, mil3, mal3);
-    return clip(c, mil1, mal1);
-}
-
-RG_FORCEINLINE uint16_t rg_mode9_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a2, a7);
-    auto mil2 = std::min(a2, a7);
-
-    auto mal3 = std::max(a3, a6);
-    auto mil3 = std::min(a3, a6);
-
-    auto mal4 = std::max(a4, a5);
-    auto mil4 = std::min(a4, a5);
-
-    auto d1 = subs_16_c(mal1, mil1);
-    auto d2 = subs_16_c(mal2, mil2);
-    auto d3 = subs_16_c(mal3, mil3);
-    auto d4 = subs_16_c(mal4, mil4);
-
-    auto mindiff = std::min(std::min(std::min(d1, d2), d3), d4);
-
-    if (mindiff == d4) return clip_16(c, mil4, mal4);
-    if (mindiff == d2) return clip_16(c, mil2, mal2);
-    if (mindiff == d3) return clip_16(c, mil3, mal3);
-    return clip_16(c, mil1, mal1);
-}
-
-RG_FORCEINLINE float rg_mode9_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a2, a7);
-    auto mil2 = std::min(a2, a7);
-
-    auto mal3 = std::max(a3, a6);
-    auto mil3 = std::min(a3, a6);
-
-    auto mal4 = std::max(a4, a5);
-    auto mil4 = std::min(a4, a5);
-
-    auto d1 = subs_32_c_for_diff(mal1, mil1);
-    auto d2 = subs_32_c_for_diff(mal2, mil2);
-    auto d3 = subs_32_c_for_diff(mal3, mil3);
-    auto d4 = subs_32_c_for_diff(mal4, mil4);
-
-    auto mindiff = std::min(std::min(std::min(d1, d2), d3), d4);
-
-    if (mindiff == d4) return clip_32(c, mil4, mal4);
-    if (mindiff == d2) return clip_32(c, mil2, mal2);
-    if (mindiff == d3) return clip_32(c, mil3, mal3);
-    return clip_32(c, mil1, mal1);
-}
-
-// ------------
-
-RG_FORCEINLINE uint8_t rg_mode10_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    auto d1 = std::abs(c - a1);
-    auto d2 = std::abs(c - a2);
-    auto d3 = std::abs(c - a3);
-    auto d4 = std::abs(c - a4);
-    auto d5 = std::abs(c - a5);
-    auto d6 = std::abs(c - a6);
-    auto d7 = std::abs(c - a7);
-    auto d8 = std::abs(c - a8);
-
-    auto mindiff = std::min(std::min(std::min(std::min(std::min(std::min(std::min(d1, d2), d3), d4), d5), d6), d7), d8);
-
-    if (mindiff == d7) return a7;
-    if (mindiff == d8) return a8;
-    if (mindiff == d6) return a6;
-    if (mindiff == d2) return a2;
-    if (mindiff == d3) return a3;
-    if (mindiff == d1) return a1;
-    if (mindiff == d5) return a5;
-    return a4;
-}
-
-RG_FORCEINLINE uint16_t rg_mode10_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    auto d1 = std::abs(c - a1);
-    auto d2 = std::abs(c - a2);
-    auto d3 = std::abs(c - a3);
-    auto d4 = std::abs(c - a4);
-    auto d5 = std::abs(c - a5);
-    auto d6 = std::abs(c - a6);
-    auto d7 = std::abs(c - a7);
-    auto d8 = std::abs(c - a8);
-
-    auto mindiff = std::min(std::min(std::min(std::min(std::min(std::min(std::min(d1, d2), d3), d4), d5), d6), d7), d8);
-
-    if (mindiff == d7) return a7;
-    if (mindiff == d8) return a8;
-    if (mindiff == d6) return a6;
-    if (mindiff == d2) return a2;
-    if (mindiff == d3) return a3;
-    if (mindiff == d1) return a1;
-    if (mindiff == d5) return a5;
-    return a4;
-}
-
-RG_FORCEINLINE float rg_mode10_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    auto d1 = std::abs(c - a1);
-    auto d2 = std::abs(c - a2);
-    auto d3 = std::abs(c - a3);
-    auto d4 = std::abs(c - a4);
-    auto d5 = std::abs(c - a5);
-    auto d6 = std::abs(c - a6);
-    auto d7 = std::abs(c - a7);
-    auto d8 = std::abs(c - a8);
-
-    auto mindiff = std::min(std::min(std::min(std::min(std::min(std::min(std::min(d1, d2), d3), d4), d5), d6), d7), d8);
-
-    if (mindiff == d7) return a7;
-    if (mindiff == d8) return a8;
-    if (mindiff == d6) return a6;
-    if (mindiff == d2) return a2;
-    if (mindiff == d3) return a3;
-    if (mindiff == d1) return a1;
-    if (mindiff == d5) return a5;
-    return a4;
-}
-
-// ------------
-
-RG_FORCEINLINE uint8_t rg_mode11_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-    // fixme: SSE does not work like this!
-    int	sum = 4 * c + 2 * (a2 + a4 + a5 + a7) + a1 + a3 + a6 + a8;
-    int	val = (sum + 8) >> 4;
-
-    return val;
-}
-
-RG_FORCEINLINE uint16_t rg_mode11_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    int	sum = 4 * c + 2 * (a2 + a4 + a5 + a7) + a1 + a3 + a6 + a8;
-    int	val = (sum + 8) >> 4;
-
-    return val;
-}
-
 RG_FORCEINLINE float rg_mode11_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
     LOAD_SQUARE_CPP_32(pSrc, srcPitch);
 
@@ -780,26 +499,6 @@ RG_FORCEINLINE float rg_mode11_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
 
 // ------------
 
-//rounding does not match
-RG_FORCEINLINE uint8_t rg_mode12_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-
-    int	sum = 4 * c + 2 * (a2 + a4 + a5 + a7) + a1 + a3 + a6 + a8;
-    int	val = (sum + 8) >> 4;
-
-    return val;
-}
-
-RG_FORCEINLINE uint16_t rg_mode12_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    int	sum = 4 * c + 2 * (a2 + a4 + a5 + a7) + a1 + a3 + a6 + a8;
-    int	val = (sum + 8) >> 4;
-
-    return val;
-}
-
 RG_FORCEINLINE float rg_mode12_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
     LOAD_SQUARE_CPP_32(pSrc, srcPitch);
 
@@ -809,48 +508,22 @@ RG_FORCEINLINE float rg_mode12_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
     return val;
 }
 
-// ------------
-
-RG_FORCEINLINE uint8_t rg_mode13_and14_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    auto d1 = std::abs(a1 - a8);
-    auto d2 = std::abs(a2 - a7);
-    auto d3 = std::abs(a3 - a6);
-
-    auto mindiff = std::min(std::min(d1, d2), d3);
-
-    if (mindiff == d2) return (a2 + a7 + 1) / 2;
-    if (mindiff == d3) return (a3 + a6 + 1) / 2;
-    return (a1 + a8 + 1) / 2;
+// (a + b + 1) >> 1 like pavgb/pavgw
+static RG_FORCEINLINE int avg_up_c(int a, int b) {
+    return (a + b + 1) >> 1;
 }
 
-RG_FORCEINLINE uint16_t rg_mode13_and14_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    auto d1 = std::abs(a1 - a8);
-    auto d2 = std::abs(a2 - a7);
-    auto d3 = std::abs(a3 - a6);
-
-    auto mindiff = std::min(std::min(d1, d2), d3);
-
-    if (mindiff == d2) return (a2 + a7 + 1) / 2;
-    if (mindiff == d3) return (a3 + a6 + 1) / 2;
-    return (a1 + a8 + 1) / 2;
-}
-
-RG_FORCEINLINE float rg_mode13_and14_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    auto d1 = std::abs(a1 - a8);
-    auto d2 = std::abs(a2 - a7);
-    auto d3 = std::abs(a3 - a6);
+// exact=True: the pavgb chain of the AviSynth SSE2 mode 12, integer formats only
+template<typename pixel_t>
+RG_FORCEINLINE pixel_t rg_mode12_exact_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_CPP_0(pixel_t, pSrc, srcPitch);
 
-    auto mindiff = std::min(std::min(d1, d2), d3);
+    int a123 = avg_up_c(a2, avg_up_c(a1, a3));
+    int a678 = avg_up_c(a7, avg_up_c(a6, a8));
+    int a4c5 = avg_up_c(c, avg_up_c(a4, a5));
+    int a123678 = std::max(avg_up_c(a123, a678) - 1, 0); // psubusb
 
-    if (mindiff == d2) return (a2 + a7) / 2.0f; // (a2 + a7 + 1) / 2;
-    if (mindiff == d3) return (a3 + a6) / 2.0f; // (a3 + a6 + 1) / 2;
-    return (a1 + a8) / 2.0f; // (a1 + a8 + 1) / 2;
+    return avg_up_c(a123678, a4c5);
 }
 
 // ------------
@@ -905,133 +578,6 @@ RG_FORCEINLINE float rg_mode15_and16_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPi
 }
 // ------------
 
-RG_FORCEINLINE uint8_t rg_mode17_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a2, a7);
-    auto mil2 = std::min(a2, a7);
-
-    auto mal3 = std::max(a3, a6);
-    auto mil3 = std::min(a3, a6);
-
-    auto mal4 = std::max(a4, a5);
-    auto mil4 = std::min(a4, a5);
-
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
-
-    return clip(c, std::min(lower, upper), std::max(lower, upper));
-
-    /*
-    normal removegrain
-      mi = std::min (lower, upper);
-      ma = std::max (lower, upper);
-      return clip(c, mi, ma);
-
-    repair difference:
-      mi = std::min (std::min (lower, upper), c);
-      ma = std::max (std::max (lower, upper), c);
-      return clip(val, mi, ma);
-    */
-}
-
-RG_FORCEINLINE uint16_t rg_mode17_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a2, a7);
-    auto mil2 = std::min(a2, a7);
-
-    auto mal3 = std::max(a3, a6);
-    auto mil3 = std::min(a3, a6);
-
-    auto mal4 = std::max(a4, a5);
-    auto mil4 = std::min(a4, a5);
-
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
-
-    return clip_16(c, std::min(lower, upper), std::max(lower, upper));
-}
-
-RG_FORCEINLINE float rg_mode17_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a2, a7);
-    auto mil2 = std::min(a2, a7);
-
-    auto mal3 = std::max(a3, a6);
-    auto mil3 = std::min(a3, a6);
-
-    auto mal4 = std::max(a4, a5);
-    auto mil4 = std::min(a4, a5);
-
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
-
-    return clip_32(c, std::min(lower, upper), std::max(lower, upper));
-}
-
-// ------------
-
-RG_FORCEINLINE uint8_t rg_mode18_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    auto d1 = std::max(std::abs(c - a1), std::abs(c - a8));
-    auto d2 = std::max(std::abs(c - a2), std::abs(c - a7));
-    auto d3 = std::max(std::abs(c - a3), std::abs(c - a6));
-    auto d4 = std::max(std::abs(c - a4), std::abs(c - a5));
-
-    auto mindiff = std::min(std::min(std::min(d1, d2), d3), d4);
-
-    if (mindiff == d4) return clip(c, std::min(a4, a5), std::max(a4, a5));
-    if (mindiff == d2) return clip(c, std::min(a2, a7), std::max(a2, a7));
-    if (mindiff == d3) return clip(c, std::min(a3, a6), std::max(a3, a6));
-    return clip(c, std::min(a1, a8), std::max(a1, a8));
-}
-
-RG_FORCEINLINE uint16_t rg_mode18_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    auto d1 = std::max(std::abs(c - a1), std::abs(c - a8));
-    auto d2 = std::max(std::abs(c - a2), std::abs(c - a7));
-    auto d3 = std::max(std::abs(c - a3), std::abs(c - a6));
-    auto d4 = std::max(std::abs(c - a4), std::abs(c - a5));
-
-    auto mindiff = std::min(std::min(std::min(d1, d2), d3), d4);
-
-    if (mindiff == d4) return clip_16(c, std::min(a4, a5), std::max(a4, a5));
-    if (mindiff == d2) return clip_16(c, std::min(a2, a7), std::max(a2, a7));
-    if (mindiff == d3) return clip_16(c, std::min(a3, a6), std::max(a3, a6));
-    return clip_16(c, std::min(a1, a8), std::max(a1, a8));
-}
-
-RG_FORCEINLINE float rg_mode18_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    auto d1 = std::max(std::abs(c - a1), std::abs(c - a8));
-    auto d2 = std::max(std::abs(c - a2), std::abs(c - a7));
-    auto d3 = std::max(std::abs(c - a3), std::abs(c - a6));
-    auto d4 = std::max(std::abs(c - a4), std::abs(c - a5));
-
-    auto mindiff = std::min(std::min(std::min(d1, d2), d3), d4);
-
-    if (mindiff == d4) return clip_32(c, std::min(a4, a5), std::max(a4, a5));
-    if (mindiff == d2) return clip_32(c, std::min(a2, a7), std::max(a2, a7));
-    if (mindiff == d3) return clip_32(c, std::min(a3, a6), std::max(a3, a6));
-    return clip_32(c, std::min(a1, a8), std::max(a1, a8));
-}
-
-// ------------
-
 RG_FORCEINLINE uint8_t rg_mode19_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
     LOAD_SQUARE_CPP(pSrc, srcPitch);
     //this one is faster but rounded a bit differently. It's not like anyone will be using C anyway
@@ -1066,25 +612,18 @@ RG_FORCEINLINE float rg_mode19_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
     return val;
 }
 
-// ------------
-
-RG_FORCEINLINE uint8_t rg_mode20_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
+// exact=True: like rg_mode19_cpp, but the - 1 saturates at 0 like the psubusb of the AviSynth SSE2 version
+template<typename pixel_t>
+RG_FORCEINLINE pixel_t rg_mode19_exact_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_CPP_0(pixel_t, pSrc, srcPitch);
 
-    int sum = a1 + a2 + a3 + a4 + c + a5 + a6 + a7 + a8;
-    int val = (sum + 4) / 9;
+    int a1368 = std::max(avg_up_c(avg_up_c(a1, a3), avg_up_c(a6, a8)) - 1, 0);
+    int a2457 = avg_up_c(avg_up_c(a2, a5), avg_up_c(a4, a7));
 
-    return val;
+    return avg_up_c(a1368, a2457);
 }
 
-RG_FORCEINLINE uint16_t rg_mode20_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    int sum = a1 + a2 + a3 + a4 + c + a5 + a6 + a7 + a8;
-    int val = (sum + 4) / 9;
-
-    return val;
-}
+// ------------
 
 RG_FORCEINLINE float rg_mode20_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
     LOAD_SQUARE_CPP_32(pSrc, srcPitch);
@@ -1151,51 +690,6 @@ RG_FORCEINLINE float rg_mode21_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
 }
 
 
-// ------------
-
-RG_FORCEINLINE uint8_t rg_mode22_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    uint8_t l1 = (a1 + a8 + 1) / 2;
-    uint8_t l2 = (a2 + a7 + 1) / 2;
-    uint8_t l3 = (a3 + a6 + 1) / 2;
-    uint8_t l4 = (a4 + a5 + 1) / 2;
-
-    auto ma = std::max(std::max(std::max(l1, l2), l3), l4);
-    auto mi = std::min(std::min(std::min(l1, l2), l3), l4);
-
-    return clip(c, mi, ma);
-}
-
-RG_FORCEINLINE uint16_t rg_mode22_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    uint16_t l1 = (a1 + a8 + 1) / 2;
-    uint16_t l2 = (a2 + a7 + 1) / 2;
-    uint16_t l3 = (a3 + a6 + 1) / 2;
-    uint16_t l4 = (a4 + a5 + 1) / 2;
-
-    auto ma = std::max(std::max(std::max(l1, l2), l3), l4);
-    auto mi = std::min(std::min(std::min(l1, l2), l3), l4);
-
-    return clip_16(c, mi, ma);
-}
-
-RG_FORCEINLINE float rg_mode22_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    // float: no integer tricks, same as 21
-    float l1 = (a1 + a8) / 2.0f;
-    float l2 = (a2 + a7) / 2.0f;
-    float l3 = (a3 + a6) / 2.0f;
-    float l4 = (a4 + a5) / 2.0f;
-
-    auto ma = std::max(std::max(std::max(l1, l2), l3), l4);
-    auto mi = std::min(std::min(std::min(l1, l2), l3), l4);
-
-    return clip_32(c, mi, ma);
-}
-
 // ------------
 
 RG_FORCEINLINE uint8_t rg_mode23_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
@@ -1233,8 +727,7 @@ RG_FORCEINLINE uint8_t rg_mode23_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
     return adds_c(subs_c(c, u), d);
 }
 
-template<int bits_per_pixel>
-RG_FORCEINLINE uint16_t rg_mode23_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+RG_FORCEINLINE uint16_t rg_mode23_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch, int pixel_max) {
     LOAD_SQUARE_CPP_16(pSrc, srcPitch);
 
     auto mal1 = std::max(a1, a8);
@@ -1266,7 +759,7 @@ RG_FORCEINLINE uint16_t rg_mode23_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch
     auto d4 = std::min(subs_16_c(mil4, c), linediff4);
     auto d = std::max(std::max(std::max(std::max(d1, d2), d3), d4), 0);
 
-    return adds_16_c<bits_per_pixel>(subs_16_c(c, u), d);
+    return adds_16_c(subs_16_c(c, u), d, pixel_max);
 }
 
 template<bool chroma>
@@ -1351,8 +844,7 @@ RG_FORCEINLINE uint8_t rg_mode24_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
     return adds_c(subs_c(c, u), d);
 }
 
-template<int bits_per_pixel>
-RG_FORCEINLINE uint16_t rg_mode24_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+RG_FORCEINLINE uint16_t rg_mode24_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch, int pixel_max) {
     LOAD_SQUARE_CPP_16(pSrc, srcPitch);
 
     auto mal1 = std::max(a1, a8);
@@ -1394,7 +886,7 @@ RG_FORCEINLINE uint16_t rg_mode24_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch
     auto d4 = std::min(t4, subs_16_c(linediff4, t4));
     auto d = std::max(std::max(std::max(std::max(d1, d2), d3), d4), 0);
 
-    return adds_16_c<bits_per_pixel>(subs_16_c(c, u), d);
+    return adds_16_c(subs_16_c(c, u), d, pixel_max);
 }
 
 template<bool chroma>
@@ -1456,44 +948,43 @@ RG_FORCEINLINE uint8_t rg_mode25_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
     int SSE4, SSE5; // SSE4_minus, SSE5_plus; // global collectors
     int SSE6, SSE7; // SSE6_actual_minus, SSE7_actual_plus the actual results
 
-    neighbourdiff_c<8>(SSE4, SSE5, c, a4);
+    neighbourdiff_c(SSE4, SSE5, c, a4, 255);
     // first result fill into collectors SSE4 and SSE5, no comparison
 
-    neighbourdiff_c<8>(SSE6, SSE7, c, a5);
+    neighbourdiff_c(SSE6, SSE7, c, a5, 255);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<8>(SSE6, SSE7, c, a1);
+    neighbourdiff_c(SSE6, SSE7, c, a1, 255);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<8>(SSE6, SSE7, c, a2);
+    neighbourdiff_c(SSE6, SSE7, c, a2, 255);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<8>(SSE6, SSE7, c, a3);
+    neighbourdiff_c(SSE6, SSE7, c, a3, 255);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<8>(SSE6, SSE7, c, a6);
+    neighbourdiff_c(SSE6, SSE7, c, a6, 255);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<8>(SSE6, SSE7, c, a7);
+    neighbourdiff_c(SSE6, SSE7, c, a7, 255);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<8>(SSE6, SSE7, c, a8);
+    neighbourdiff_c(SSE6, SSE7, c, a8, 255);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    auto result = sharpen_c<8>(c, SSE4, SSE5);
+    auto result = sharpen_c(c, SSE4, SSE5, 255);
 
     return result;
 }
 
-template<int bits_per_pixel>
-RG_FORCEINLINE uint16_t rg_mode25_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+RG_FORCEINLINE uint16_t rg_mode25_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch, int pixel_max) {
     LOAD_SQUARE_CPP_16(pSrc, srcPitch);
 
     /*
@@ -1504,38 +995,38 @@ RG_FORCEINLINE uint16_t rg_mode25_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch
     int SSE4, SSE5; // SSE4_minus, SSE5_plus; // global collectors
     int SSE6, SSE7; // SSE6_actual_minus, SSE7_actual_plus the actual results
 
-    neighbourdiff_c<bits_per_pixel>(SSE4, SSE5, c, a4);
+    neighbourdiff_c(SSE4, SSE5, c, a4, pixel_max);
     // first result fill into collectors SSE4 and SSE5, no comparison
 
-    neighbourdiff_c<bits_per_pixel>(SSE6, SSE7, c, a5);
+    neighbourdiff_c(SSE6, SSE7, c, a5, pixel_max);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<bits_per_pixel>(SSE6, SSE7, c, a1);
+    neighbourdiff_c(SSE6, SSE7, c, a1, pixel_max);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<bits_per_pixel>(SSE6, SSE7, c, a2);
+    neighbourdiff_c(SSE6, SSE7, c, a2, pixel_max);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<bits_per_pixel>(SSE6, SSE7, c, a3);
+    neighbourdiff_c(SSE6, SSE7, c, a3, pixel_max);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<bits_per_pixel>(SSE6, SSE7, c, a6);
+    neighbourdiff_c(SSE6, SSE7, c, a6, pixel_max);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<bits_per_pixel>(SSE6, SSE7, c, a7);
+    neighbourdiff_c(SSE6, SSE7, c, a7, pixel_max);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    neighbourdiff_c<bits_per_pixel>(SSE6, SSE7, c, a8);
+    neighbourdiff_c(SSE6, SSE7, c, a8, pixel_max);
     SSE4 = std::min(SSE4, SSE6);
     SSE5 = std::min(SSE5, SSE7);
 
-    auto result = sharpen_c<bits_per_pixel>(c, SSE4, SSE5);
+    auto result = sharpen_c(c, SSE4, SSE5, pixel_max);
 
     return result;
 }
@@ -1590,422 +1081,254 @@ RG_FORCEINLINE float rg_mode25_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
 
 // ------------
 
-RG_FORCEINLINE uint8_t rg_mode26_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
+// Running-sum 3x3 convolution engine.
+// Every source row is filtered horizontally once into a ring of three row buffers and reused by the
+// three output rows that need it, an output row is then a vertical combination of the buffered rows.
+// The passes handle columns 1 .. width - 2, the first and last row and column are copied.
 
-    auto mal1 = std::max(a1, a2);
-    auto mil1 = std::min(a1, a2);
+template<typename pixel_t, typename acc_t>
+using ConvHorizontalPass = void(*)(const pixel_t* pSrc, acc_t* pSum, int width, const ConvParams& params);
 
-    auto mal2 = std::max(a2, a3);
-    auto mil2 = std::min(a2, a3);
+template<typename pixel_t, typename acc_t>
+using ConvVerticalPass = void(*)(const acc_t* pAbove, const acc_t* pSum, const acc_t* pBelow, pixel_t* pDst, int width, const ConvParams& params);
 
-    auto mal3 = std::max(a3, a5);
-    auto mil3 = std::min(a3, a5);
+template<typename pixel_t, typename acc_t, ConvHorizontalPass<pixel_t, acc_t> horizontal, ConvVerticalPass<pixel_t, acc_t> vertical>
+static void process_plane_conv(const uint8_t* pSrc8, uint8_t* pDst8, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, const ConvParams& params) {
+    if (width < 3 || height < 3) {
+        vsh::bitblt(pDst8, dstPitch, pSrc8, srcPitch, width * sizeof(pixel_t), height);
+        return;
+    }
 
-    auto mal4 = std::max(a5, a8);
-    auto mil4 = std::min(a5, a8);
+    vsh::bitblt(pDst8, dstPitch, pSrc8, srcPitch, width * sizeof(pixel_t), 1);
 
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
+    // one slot per buffered row, holding the sums of every term one after another
+    const ptrdiff_t slot = static_cast<ptrdiff_t>(params.terms) * width;
+    std::unique_ptr<acc_t[]> sums(new acc_t[3 * slot]);
+    acc_t* pAbove = sums.get();
+    acc_t* pSum = pAbove + slot;
+    acc_t* pBelow = pSum + slot;
 
-    mal1 = std::max(a7, a8);
-    mil1 = std::min(a7, a8);
+    pixel_t* pDst = reinterpret_cast<pixel_t*>(pDst8);
+    const pixel_t* pSrc = reinterpret_cast<const pixel_t*>(pSrc8);
 
-    mal2 = std::max(a6, a7);
-    mil2 = std::min(a6, a7);
+    dstPitch /= sizeof(pixel_t);
+    srcPitch /= sizeof(pixel_t);
 
-    mal3 = std::max(a4, a6);
-    mil3 = std::min(a4, a6);
+    horizontal(pSrc, pAbove, width, params);
+    pSrc += srcPitch;
+    pDst += dstPitch;
+    horizontal(pSrc, pSum, width, params);
+    for (int y = 1; y < height - 1; ++y) {
+        horizontal(pSrc + srcPitch, pBelow, width, params);
 
-    mal4 = std::max(a1, a4);
-    mil4 = std::min(a1, a4);
+        pDst[0] = pSrc[0];
+        vertical(pAbove, pSum, pBelow, pDst, width, params);
+        pDst[width - 1] = pSrc[width - 1];
 
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
+        // the row above is not needed anymore, the next source row goes there
+        acc_t* pFree = pAbove;
+        pAbove = pSum;
+        pSum = pBelow;
+        pBelow = pFree;
 
-    return clip(c, std::min(lower, upper), std::max(lower, upper));
-}
+        pSrc += srcPitch;
+        pDst += dstPitch;
+    }
 
-RG_FORCEINLINE uint16_t rg_mode26_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a2);
-    auto mil1 = std::min(a1, a2);
-
-    auto mal2 = std::max(a2, a3);
-    auto mil2 = std::min(a2, a3);
-
-    auto mal3 = std::max(a3, a5);
-    auto mil3 = std::min(a3, a5);
-
-    auto mal4 = std::max(a5, a8);
-    auto mil4 = std::min(a5, a8);
-
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
-
-    mal1 = std::max(a7, a8);
-    mil1 = std::min(a7, a8);
-
-    mal2 = std::max(a6, a7);
-    mil2 = std::min(a6, a7);
-
-    mal3 = std::max(a4, a6);
-    mil3 = std::min(a4, a6);
-
-    mal4 = std::max(a1, a4);
-    mil4 = std::min(a1, a4);
-
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
-
-    return clip_16(c, std::min(lower, upper), std::max(lower, upper));
+    vsh::bitblt((uint8_t*)pDst, dstPitch * sizeof(pixel_t), (uint8_t*)pSrc, srcPitch * sizeof(pixel_t), width * sizeof(pixel_t), 1);
 }
 
-RG_FORCEINLINE float rg_mode26_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a2);
-    auto mil1 = std::min(a1, a2);
-
-    auto mal2 = std::max(a2, a3);
-    auto mil2 = std::min(a2, a3);
-
-    auto mal3 = std::max(a3, a5);
-    auto mil3 = std::min(a3, a5);
+// Separable RemoveGrain modes: 11 and 12 are the 1-2-1 kernel in both directions, 20 is the box.
+// Integer sums are exact, so the result is the same as summing all 9 taps at once.
+// Float sums are rounded in a different order than the 9-tap kernels, the last bit may differ.
 
-    auto mal4 = std::max(a5, a8);
-    auto mil4 = std::min(a5, a8);
-
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
-
-    mal1 = std::max(a7, a8);
-    mil1 = std::min(a7, a8);
-
-    mal2 = std::max(a6, a7);
-    mil2 = std::min(a6, a7);
-
-    mal3 = std::max(a4, a6);
-    mil3 = std::min(a4, a6);
-
-    mal4 = std::max(a1, a4);
-    mil4 = std::min(a1, a4);
-
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
-
-    return clip_32(c, std::min(lower, upper), std::max(lower, upper));
+template<int mode, typename sum_t>
+static RG_FORCEINLINE sum_t sep_taps_c(sum_t a, sum_t b, sum_t c) {
+    return mode == 20 ? a + b + c : a + 2 * b + c;
 }
 
-// ------------
-
-RG_FORCEINLINE uint8_t rg_mode27_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a1, a2);
-    auto mil2 = std::min(a1, a2);
-
-    auto mal3 = std::max(a7, a8);
-    auto mil3 = std::min(a7, a8);
-
-    auto mal4 = std::max(a2, a7);
-    auto mil4 = std::min(a2, a7);
-
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
-
-    mal1 = std::max(a2, a3);
-    mil1 = std::min(a2, a3);
-
-    mal2 = std::max(a6, a7);
-    mil2 = std::min(a6, a7);
-
-    mal3 = std::max(a3, a6);
-    mil3 = std::min(a3, a6);
-
-    mal4 = std::max(a3, a5);
-    mil4 = std::min(a3, a5);
-
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
-
-    mal1 = std::max(a4, a6);
-    mil1 = std::min(a4, a6);
-
-    mal2 = std::max(a4, a5);
-    mil2 = std::min(a4, a5);
-
-    mal3 = std::max(a5, a8);
-    mil3 = std::min(a5, a8);
-
-    mal4 = std::max(a1, a4);
-    mil4 = std::min(a1, a4);
-
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
-
-    return clip(c, std::min(lower, upper), std::max(lower, upper));
+template<int mode>
+static RG_FORCEINLINE int sep_round_c(int sum) {
+    return mode == 20 ? (sum + 4) / 9 : (sum + 8) >> 4;
 }
 
-RG_FORCEINLINE uint16_t rg_mode27_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a1, a2);
-    auto mil2 = std::min(a1, a2);
-
-    auto mal3 = std::max(a7, a8);
-    auto mil3 = std::min(a7, a8);
-
-    auto mal4 = std::max(a2, a7);
-    auto mil4 = std::min(a2, a7);
-
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
-
-    mal1 = std::max(a2, a3);
-    mil1 = std::min(a2, a3);
-
-    mal2 = std::max(a6, a7);
-    mil2 = std::min(a6, a7);
-
-    mal3 = std::max(a3, a6);
-    mil3 = std::min(a3, a6);
-
-    mal4 = std::max(a3, a5);
-    mil4 = std::min(a3, a5);
-
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
-
-    mal1 = std::max(a4, a6);
-    mil1 = std::min(a4, a6);
-
-    mal2 = std::max(a4, a5);
-    mil2 = std::min(a4, a5);
-
-    mal3 = std::max(a5, a8);
-    mil3 = std::min(a5, a8);
-
-    mal4 = std::max(a1, a4);
-    mil4 = std::min(a1, a4);
-
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
-
-    return clip_16(c, std::min(lower, upper), std::max(lower, upper));
+template<int mode>
+static RG_FORCEINLINE float sep_round_c(float sum) {
+    return mode == 20 ? sum / 9.0f : sum / 16.0f;
 }
 
-RG_FORCEINLINE float rg_mode27_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a8);
-    auto mil1 = std::min(a1, a8);
-
-    auto mal2 = std::max(a1, a2);
-    auto mil2 = std::min(a1, a2);
-
-    auto mal3 = std::max(a7, a8);
-    auto mil3 = std::min(a7, a8);
-
-    auto mal4 = std::max(a2, a7);
-    auto mil4 = std::min(a2, a7);
-
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
-
-    mal1 = std::max(a2, a3);
-    mil1 = std::min(a2, a3);
-
-    mal2 = std::max(a6, a7);
-    mil2 = std::min(a6, a7);
-
-    mal3 = std::max(a3, a6);
-    mil3 = std::min(a3, a6);
-
-    mal4 = std::max(a3, a5);
-    mil4 = std::min(a3, a5);
-
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
-
-    mal1 = std::max(a4, a6);
-    mil1 = std::min(a4, a6);
-
-    mal2 = std::max(a4, a5);
-    mil2 = std::min(a4, a5);
-
-    mal3 = std::max(a5, a8);
-    mil3 = std::min(a5, a8);
-
-    mal4 = std::max(a1, a4);
-    mil4 = std::min(a1, a4);
-
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
-
-    return clip_32(c, std::min(lower, upper), std::max(lower, upper));
+template<typename pixel_t, typename acc_t, int mode>
+static void sep_horizontal_c(const pixel_t* pSrc, acc_t* pSum, int width, const ConvParams&) {
+    for (int x = 1; x < width - 1; x += 1)
+        pSum[x] = sep_taps_c<mode, acc_t>(pSrc[x - 1], pSrc[x], pSrc[x + 1]);
 }
 
-// ------------
-
-RG_FORCEINLINE uint8_t rg_mode28_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a2);
-    auto mil1 = std::min(a1, a2);
-
-    auto mal2 = std::max(a2, a3);
-    auto mil2 = std::min(a2, a3);
-
-    auto mal3 = std::max(a3, a5);
-    auto mil3 = std::min(a3, a5);
-
-    auto mal4 = std::max(a5, a8);
-    auto mil4 = std::min(a5, a8);
-
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
-
-    mal1 = std::max(a7, a8);
-    mil1 = std::min(a7, a8);
-
-    mal2 = std::max(a6, a7);
-    mil2 = std::min(a6, a7);
-
-    mal3 = std::max(a4, a6);
-    mil3 = std::min(a4, a6);
-
-    mal4 = std::max(a1, a4);
-    mil4 = std::min(a1, a4);
-
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
-
-    mal1 = std::max(a1, a8);
-    mil1 = std::min(a1, a8);
-
-    mal2 = std::max(a3, a6);
-    mil2 = std::min(a3, a6);
-
-    mal3 = std::max(a2, a7);
-    mil3 = std::min(a2, a7);
-
-    mal4 = std::max(a4, a5);
-    mil4 = std::min(a4, a5);
-
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
-
-    return clip(c, std::min(lower, upper), std::max(lower, upper));
+template<typename pixel_t, typename acc_t, int mode>
+static void sep_vertical_c(const acc_t* pAbove, const acc_t* pSum, const acc_t* pBelow, pixel_t* pDst, int width, const ConvParams&) {
+    for (int x = 1; x < width - 1; x += 1)
+        pDst[x] = sep_round_c<mode>(sep_taps_c<mode, acc_t>(pAbove[x], pSum[x], pBelow[x]));
 }
 
-RG_FORCEINLINE uint16_t rg_mode28_cpp_16(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_16(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a2);
-    auto mil1 = std::min(a1, a2);
-
-    auto mal2 = std::max(a2, a3);
-    auto mil2 = std::min(a2, a3);
-
-    auto mal3 = std::max(a3, a5);
-    auto mil3 = std::min(a3, a5);
-
-    auto mal4 = std::max(a5, a8);
-    auto mil4 = std::min(a5, a8);
+// Convolution3x3: sums are floats, exact for integer formats as long as they stay below 2^24.
+// The vector passes use the same order of operations, products are not fused, see common.h.
 
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
+template<typename pixel_t>
+static void conv_horizontal_c(const pixel_t* pSrc, float* pSum, int width, const ConvParams& params) {
+    for (int t = 0; t < params.terms; ++t) {
+        const float* w = params.horizontal[t];
+        for (int x = 1; x < width - 1; x += 1)
+            pSum[x] = w[0] * pSrc[x - 1] + w[1] * pSrc[x] + w[2] * pSrc[x + 1];
+        pSum += width;
+    }
+}
 
-    mal1 = std::max(a7, a8);
-    mil1 = std::min(a7, a8);
+template<typename pixel_t>
+static void conv_vertical_c(const float* pAbove, const float* pSum, const float* pBelow, pixel_t* pDst, int width, const ConvParams& params) {
+    for (int x = 1; x < width - 1; x += 1) {
+        const float* v = params.vertical[0];
+        float sum = v[0] * pAbove[x] + v[1] * pSum[x] + v[2] * pBelow[x];
+        for (int t = 1; t < params.terms; ++t) {
+            const ptrdiff_t i = static_cast<ptrdiff_t>(t) * width + x;
+            v = params.vertical[t];
+            sum += v[0] * pAbove[i] + v[1] * pSum[i] + v[2] * pBelow[i];
+        }
+        sum = sum / params.divisor;
+
+        if constexpr (sizeof(pixel_t) == 4) // float: no clamping or rounding
+            pDst[x] = sum;
+        else
+            pDst[x] = static_cast<pixel_t>(std::min(std::max(sum, 0.0f), params.pixel_max) + 0.5f);
+    }
+}
+
+// Custom: runs the register program of an expression, see CustomProgram.
+// Integer pixels are evaluated as int, every instruction keeps them in 0 .. pixel_max.
 
-    mal2 = std::max(a6, a7);
-    mil2 = std::min(a6, a7);
+template<typename pixel_t>
+using custom_reg_t = std::conditional_t<std::is_floating_point_v<pixel_t>, float, int>;
 
-    mal3 = std::max(a4, a6);
-    mil3 = std::min(a4, a6);
+// regs: constants already in place, the square and the results are written here
+template<typename pixel_t>
+static RG_FORCEINLINE pixel_t custom_eval_c(const uint8_t* pSrc, ptrdiff_t srcPitch, custom_reg_t<pixel_t>* regs, const CustomProgram& program) {
+    using reg_t = custom_reg_t<pixel_t>;
+    LOAD_SQUARE_CPP_0(pixel_t, pSrc, srcPitch);
+
+    regs[0] = a1; regs[1] = a2; regs[2] = a3;
+    regs[3] = a4; regs[4] = c;  regs[5] = a5;
+    regs[6] = a6; regs[7] = a7; regs[8] = a8;
+
+    for (int i = 0; i < program.num_instructions; ++i) {
+        const CustomInstr& instr = program.code[i];
+        const reg_t x = regs[instr.src[0]];
+        const reg_t y = regs[instr.src[1]];
+        reg_t result;
+        switch (instr.op) {
+        case CustomOp::min: result = std::min(x, y); break;
+        case CustomOp::max: result = std::max(x, y); break;
+        case CustomOp::clip: result = std::max(std::min(x, regs[instr.src[2]]), y); break;
+        case CustomOp::absdiff: result = std::abs(x - y); break;
+        default:
+            if constexpr (std::is_floating_point_v<pixel_t>) { // float: no rounding or saturation
+                if (instr.op == CustomOp::avg) result = (x + y) / 2.0f;
+                else if (instr.op == CustomOp::adds) result = x + y;
+                else result = x - y;
+            }
+            else {
+                if (instr.op == CustomOp::avg) result = (x + y + 1) / 2;
+                else if (instr.op == CustomOp::adds) result = std::min(x + y, program.pixel_max);
+                else result = std::max(x - y, 0);
+            }
+        }
+        regs[instr.dst] = result;
+    }
+
+    return static_cast<pixel_t>(regs[program.result]);
+}
 
-    mal4 = std::max(a1, a4);
-    mil4 = std::min(a1, a4);
+template<typename pixel_t>
+static void custom_load_constants_c(custom_reg_t<pixel_t>* regs, const CustomProgram& program) {
+    for (int i = 0; i < program.num_constants; ++i)
+        regs[CustomProgram::square_registers + i] = static_cast<custom_reg_t<pixel_t>>(program.constants[i]);
+}
 
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
+template<typename pixel_t>
+static void process_plane_custom_c(const uint8_t* pSrc8, uint8_t* pDst8, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, const CustomProgram& program) {
+    custom_reg_t<pixel_t> regs[CustomProgram::max_registers];
+    custom_load_constants_c<pixel_t>(regs, program);
 
-    mal1 = std::max(a1, a8);
-    mil1 = std::min(a1, a8);
+    vsh::bitblt(pDst8, dstPitch, pSrc8, srcPitch, width * sizeof(pixel_t), 1);
 
-    mal2 = std::max(a3, a6);
-    mil2 = std::min(a3, a6);
+    pixel_t* pDst = reinterpret_cast<pixel_t*>(pDst8);
+    const pixel_t* pSrc = reinterpret_cast<const pixel_t*>(pSrc8);
 
-    mal3 = std::max(a2, a7);
-    mil3 = std::min(a2, a7);
+    dstPitch /= sizeof(pixel_t);
+    const ptrdiff_t srcPitchOrig = srcPitch;
+    srcPitch /= sizeof(pixel_t);
 
-    mal4 = std::max(a4, a5);
-    mil4 = std::min(a4, a5);
+    pSrc += srcPitch;
+    pDst += dstPitch;
+    for (int y = 1; y < height - 1; ++y) {
+        pDst[0] = pSrc[0];
+        for (int x = 1; x < width - 1; x += 1)
+            pDst[x] = custom_eval_c<pixel_t>((const uint8_t*)(pSrc + x), srcPitchOrig, regs, program);
+        pDst[width - 1] = pSrc[width - 1];
 
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
+        pSrc += srcPitch;
+        pDst += dstPitch;
+    }
 
-    return clip_16(c, std::min(lower, upper), std::max(lower, upper));
+    vsh::bitblt((uint8_t*)pDst, dstPitch * sizeof(pixel_t), (uint8_t*)pSrc, srcPitch * sizeof(pixel_t), width * sizeof(pixel_t), 1);
 }
 
-RG_FORCEINLINE float rg_mode28_cpp_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
-    LOAD_SQUARE_CPP_32(pSrc, srcPitch);
-
-    auto mal1 = std::max(a1, a2);
-    auto mil1 = std::min(a1, a2);
-
-    auto mal2 = std::max(a2, a3);
-    auto mil2 = std::min(a2, a3);
-
-    auto mal3 = std::max(a3, a5);
-    auto mil3 = std::min(a3, a5);
-
-    auto mal4 = std::max(a5, a8);
-    auto mil4 = std::min(a5, a8);
-
-    auto lower = std::max(std::max(std::max(mil1, mil2), mil3), mil4);
-    auto upper = std::min(std::min(std::min(mal1, mal2), mal3), mal4);
-
-    mal1 = std::max(a7, a8);
-    mil1 = std::min(a7, a8);
+// MinBlur r=1: of the mode 11 blur and the mode 4 median the one closer to the center, the center itself
+// when they lie on both sides of it. That is the median of the three, one clip instead of the sign test.
+template<typename pixel_t>
+RG_FORCEINLINE pixel_t minblur_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    using sum_t = std::conditional_t<std::is_floating_point_v<pixel_t>, float, int>;
+    LOAD_SQUARE_CPP_0(pixel_t, pSrc, srcPitch);
 
-    mal2 = std::max(a6, a7);
-    mil2 = std::min(a6, a7);
+    // same order as rg_mode11_cpp_32 for float
+    const sum_t sum = 4 * static_cast<sum_t>(c) + 2 * (static_cast<sum_t>(a2) + a4 + a5 + a7) + a1 + a3 + a6 + a8;
+    pixel_t blur;
+    if constexpr (std::is_floating_point_v<pixel_t>)
+        blur = sum / 16.0f;
+    else
+        blur = static_cast<pixel_t>((sum + 8) >> 4);
 
-    mal3 = std::max(a4, a6);
-    mil3 = std::min(a4, a6);
+    sort3_c(a1, a4, a6);
+    sort3_c(a3, a5, a8);
 
-    mal4 = std::max(a1, a4);
-    mil4 = std::min(a1, a4);
+    pixel_t lo, hi;
+    rank_select_c<4>(a1, a4, a6, a2, a7, a3, a5, a8, lo, hi);
+    const pixel_t median = std::max(std::min(c, hi), lo);
 
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
+    return std::max(std::min(c, std::max(blur, median)), std::min(blur, median));
+}
 
-    mal1 = std::max(a1, a8);
-    mil1 = std::min(a1, a8);
+template<typename pixel_t>
+static void process_plane_minblur_c(const uint8_t* pSrc8, uint8_t* pDst8, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int) {
+    vsh::bitblt(pDst8, dstPitch, pSrc8, srcPitch, width * sizeof(pixel_t), 1);
 
-    mal2 = std::max(a3, a6);
-    mil2 = std::min(a3, a6);
+    pixel_t* pDst = reinterpret_cast<pixel_t*>(pDst8);
+    const pixel_t* pSrc = reinterpret_cast<const pixel_t*>(pSrc8);
 
-    mal3 = std::max(a2, a7);
-    mil3 = std::min(a2, a7);
+    dstPitch /= sizeof(pixel_t);
+    const ptrdiff_t srcPitchOrig = srcPitch;
+    srcPitch /= sizeof(pixel_t);
 
-    mal4 = std::max(a4, a5);
-    mil4 = std::min(a4, a5);
+    pSrc += srcPitch;
+    pDst += dstPitch;
+    for (int y = 1; y < height - 1; ++y) {
+        pDst[0] = pSrc[0];
+        for (int x = 1; x < width - 1; x += 1)
+            pDst[x] = minblur_cpp<pixel_t>((const uint8_t*)(pSrc + x), srcPitchOrig);
+        pDst[width - 1] = pSrc[width - 1];
 
-    lower = std::max(std::max(std::max(std::max(mil1, mil2), mil3), mil4), lower);
-    upper = std::min(std::min(std::min(std::min(mal1, mal2), mal3), mal4), upper);
+        pSrc += srcPitch;
+        pDst += dstPitch;
+    }
 
-    return clip_32(c, std::min(lower, upper), std::max(lower, upper));
+    vsh::bitblt((uint8_t*)pDst, dstPitch * sizeof(pixel_t), (uint8_t*)pSrc, srcPitch * sizeof(pixel_t), width * sizeof(pixel_t), 1);
 }
 
 #undef LOAD_SQUARE_CPP
@@ -0,0 +1,1655 @@
+#pragma once
+
+#ifndef __RG_FUNCTIONS_SIMD_H__
+#define __RG_FUNCTIONS_SIMD_H__
+
+#include "common.h"
+#include "rg_functions_c.h"
+
+#ifdef VCL_NAMESPACE
+using namespace VCL_NAMESPACE;
+#endif
+
+// Vectorized counterparts of rg_functions_c.h.
+// Kernels are templated on the VCL2 vector type so every instruction set
+// shares the same code, results must match the C versions bit-for-bit.
+
+// How a kernel reads and writes its pixels. simd_native<V> stores them as V itself,
+// simd_half<V> keeps fp16 pixels in memory and converts them to the float vector V with F16C.
+template<typename V>
+struct simd_native {
+    static constexpr ptrdiff_t pixel_size = sizeof(V) / V::size();
+
+    static RG_FORCEINLINE V load(const void* p) { return V().load(p); }
+    static RG_FORCEINLINE V load_partial(int n, const void* p) { return V().load_partial(n, p); }
+    static RG_FORCEINLINE void store(const V& v, void* p) { v.store(p); }
+    static RG_FORCEINLINE void store_a(const V& v, void* p) { v.store_a(p); }
+    static RG_FORCEINLINE void store_nt(const V& v, void* p) { v.store_nt(p); }
+    static RG_FORCEINLINE void store_partial(int n, const V& v, void* p) { v.store_partial(n, p); }
+
+    // edge pixels of modes 13-16, float: no +1 rounding
+    template<typename T>
+    static RG_FORCEINLINE T average(T a, T b) { return (a + b + (sizeof(T) == 4 ? 0 : 1)) / 2; }
+};
+
+template<typename V>
+struct simd_half;
+
+#if INSTRSET >= 8
+template<>
+struct simd_half<Vec8f> {
+    static constexpr ptrdiff_t pixel_size = 2;
+
+    static RG_FORCEINLINE Vec8f load(const void* p) { return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p)); }
+    static RG_FORCEINLINE void store(const Vec8f& v, void* p) { _mm_storeu_si128((__m128i*)p, _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT)); }
+    static RG_FORCEINLINE void store_a(const Vec8f& v, void* p) { _mm_store_si128((__m128i*)p, _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT)); }
+    static RG_FORCEINLINE void store_nt(const Vec8f& v, void* p) { _mm_stream_si128((__m128i*)p, _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT)); }
+
+    static RG_FORCEINLINE uint16_t average(uint16_t a, uint16_t b) {
+        return _cvtss_sh((_cvtsh_ss(a) + _cvtsh_ss(b)) / 2, _MM_FROUND_TO_NEAREST_INT);
+    }
+};
+
+// C processor for fp16 pixels: the 3x3 square is widened to float and handed to the float one
+template<CModeProcessor<float> processor>
+static uint16_t rg_half_cpp(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    float square[3][3];
+    for (int y = 0; y < 3; ++y)
+        for (int x = 0; x < 3; ++x)
+            square[y][x] = _cvtsh_ss(*(const uint16_t*)(pSrc + (y - 1) * srcPitch + (x - 1) * 2));
+
+    return _cvtss_sh(processor((const uint8_t*)&square[1][1], sizeof(square[0])), _MM_FROUND_TO_NEAREST_INT);
+}
+#endif
+
+#if INSTRSET >= 10
+template<>
+struct simd_half<Vec16f> {
+    static constexpr ptrdiff_t pixel_size = 2;
+
+    static RG_FORCEINLINE Vec16f load(const void* p) { return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)p)); }
+    static RG_FORCEINLINE Vec16f load_partial(int n, const void* p) {
+        return _mm512_cvtph_ps(_mm256_maskz_loadu_epi16(static_cast<__mmask16>((1u << n) - 1), p));
+    }
+    static RG_FORCEINLINE void store(const Vec16f& v, void* p) { _mm256_storeu_si256((__m256i*)p, _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT)); }
+    static RG_FORCEINLINE void store_a(const Vec16f& v, void* p) { _mm256_store_si256((__m256i*)p, _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT)); }
+    static RG_FORCEINLINE void store_nt(const Vec16f& v, void* p) { _mm256_stream_si256((__m256i*)p, _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT)); }
+    static RG_FORCEINLINE void store_partial(int n, const Vec16f& v, void* p) {
+        _mm256_mask_storeu_epi16(p, static_cast<__mmask16>((1u << n) - 1), _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+
+    static RG_FORCEINLINE uint16_t average(uint16_t a, uint16_t b) {
+        return _cvtss_sh((_cvtsh_ss(a) + _cvtsh_ss(b)) / 2, _MM_FROUND_TO_NEAREST_INT);
+    }
+};
+#endif
+
+// loaders for SIMD routines
+// pointers and pitch are byte-based, S is the pixel storage of the vector V
+#define LOAD_SQUARE_SIMD_S(V, S, ptr, pitch) \
+    constexpr ptrdiff_t pixel_size = S::pixel_size; \
+    V a1 = S::load((ptr) - (pitch) - pixel_size); \
+    V a2 = S::load((ptr) - (pitch)); \
+    V a3 = S::load((ptr) - (pitch) + pixel_size); \
+    V a4 = S::load((ptr) - pixel_size); \
+    V c  = S::load((ptr) ); \
+    V a5 = S::load((ptr) + pixel_size); \
+    V a6 = S::load((ptr) + (pitch) - pixel_size); \
+    V a7 = S::load((ptr) + (pitch)); \
+    V a8 = S::load((ptr) + (pitch) + pixel_size);
+
+#define LOAD_SQUARE_SIMD(V, ptr, pitch) LOAD_SQUARE_SIMD_S(V, simd_native<V>, ptr, pitch)
+
+// (a + b + 1) >> 1, pavgb/pavgw
+#if INSTRSET >= 2
+static RG_FORCEINLINE Vec16uc simd_avg(const Vec16uc& a, const Vec16uc& b) {
+    return _mm_avg_epu8(a, b);
+}
+
+static RG_FORCEINLINE Vec8us simd_avg(const Vec8us& a, const Vec8us& b) {
+    return _mm_avg_epu16(a, b);
+}
+#endif
+
+#if INSTRSET >= 8
+static RG_FORCEINLINE Vec32uc simd_avg(const Vec32uc& a, const Vec32uc& b) {
+    return _mm256_avg_epu8(a, b);
+}
+
+static RG_FORCEINLINE Vec16us simd_avg(const Vec16us& a, const Vec16us& b) {
+    return _mm256_avg_epu16(a, b);
+}
+#endif
+
+#if INSTRSET >= 10
+static RG_FORCEINLINE Vec64uc simd_avg(const Vec64uc& a, const Vec64uc& b) {
+    return _mm512_avg_epu8(a, b);
+}
+
+static RG_FORCEINLINE Vec32us simd_avg(const Vec32us& a, const Vec32us& b) {
+    return _mm512_avg_epu16(a, b);
+}
+#endif
+
+// float: no rounding
+static RG_FORCEINLINE Vec4f simd_avg(const Vec4f& a, const Vec4f& b) {
+    return (a + b) * Vec4f(0.5f);
+}
+
+static RG_FORCEINLINE Vec8f simd_avg(const Vec8f& a, const Vec8f& b) {
+    return (a + b) * Vec8f(0.5f);
+}
+
+static RG_FORCEINLINE Vec16f simd_avg(const Vec16f& a, const Vec16f& b) {
+    return (a + b) * Vec16f(0.5f);
+}
+
+// (a + b) >> 1
+template<typename V>
+static RG_FORCEINLINE V simd_avg_down(const V& a, const V& b) {
+    return simd_avg(a, b) - ((a ^ b) & V(1));
+}
+
+// operand order follows std::max(std::min(val, maximum), minimum), it matters for float
+template<typename V>
+static RG_FORCEINLINE V simd_clip(const V& val, const V& minimum, const V& maximum) {
+    return max(minimum, min(maximum, val));
+}
+
+template<typename V>
+static RG_FORCEINLINE V simd_abs_diff(const V& a, const V& b) {
+    return sub_saturated(a, b) | sub_saturated(b, a);
+}
+
+static RG_FORCEINLINE Vec4f simd_abs_diff(const Vec4f& a, const Vec4f& b) {
+    return abs(a - b);
+}
+
+static RG_FORCEINLINE Vec8f simd_abs_diff(const Vec8f& a, const Vec8f& b) {
+    return abs(a - b);
+}
+
+static RG_FORCEINLINE Vec16f simd_abs_diff(const Vec16f& a, const Vec16f& b) {
+    return abs(a - b);
+}
+
+// saturating add at the pixel maximum, 8 bit lanes saturate by themselves
+template<typename V>
+static RG_FORCEINLINE V simd_adds(const V& x, const V& y, const V& pixel_max) {
+    if constexpr (sizeof(V) / V::size() == 1)
+        return add_saturated(x, y);
+    else
+        return min(add_saturated(x, y), pixel_max);
+}
+
+template<typename V>
+static RG_FORCEINLINE V sharpen_simd(const V& center, const V& minus, const V& plus, const V& pixel_max) {
+    auto mp_diff = sub_saturated(minus, plus);
+    auto pm_diff = sub_saturated(plus, minus);
+    auto m_per2 = minus >> 1;
+    auto p_per2 = plus >> 1;
+    auto min_1 = min(p_per2, mp_diff);
+    auto min_2 = min(m_per2, pm_diff);
+    return sub_saturated(simd_adds(center, min_1, pixel_max), min_2);
+}
+
+// helper for mode 25, see neighbourdiff_c
+template<typename V>
+static RG_FORCEINLINE void neighbourdiff_simd(V& minus, V& plus, const V& center, const V& neighbour, const V& pixel_max) {
+    // equal pixels give zero on both sides through the saturated difference
+    minus = select(neighbour > center, pixel_max, sub_saturated(center, neighbour));
+    plus = select(center > neighbour, pixel_max, sub_saturated(neighbour, center));
+}
+
+// float helpers, see subs_32_c / adds_32_c and friends
+template<typename V, bool chroma>
+static RG_FORCEINLINE V subs_simd_32(const V& x, const V& y) {
+    return max(x - y, V(chroma ? -0.5f : 0.0f));
+}
+
+template<typename V, bool chroma>
+static RG_FORCEINLINE V adds_simd_32(const V& x, const V& y) {
+    return min(x + y, V(chroma ? 0.5f : 1.0f));
+}
+
+template<typename V>
+static RG_FORCEINLINE V subs_simd_32_for_diff(const V& x, const V& y) {
+    return max(x - y, V(0.0f));
+}
+
+template<typename V>
+static RG_FORCEINLINE V adds_simd_32_for_diff(const V& x, const V& y) {
+    return min(x + y, V(1.0f));
+}
+
+template<typename V, bool chroma>
+static RG_FORCEINLINE V sharpen_simd_32(const V& center, const V& minus, const V& plus) {
+    auto mp_diff = subs_simd_32_for_diff(minus, plus);
+    auto pm_diff = subs_simd_32_for_diff(plus, minus);
+    auto m_per2 = minus * V(0.5f);
+    auto p_per2 = plus * V(0.5f);
+    auto min_1 = min(p_per2, mp_diff);
+    auto min_2 = min(m_per2, pm_diff);
+    return subs_simd_32<V, chroma>(adds_simd_32<V, chroma>(center, min_1), min_2);
+}
+
+template<typename V>
+static RG_FORCEINLINE void neighbourdiff_simd_32(V& minus, V& plus, const V& center, const V& neighbour) {
+    const V max_mask = V(1.0f);
+    auto equ = center == neighbour;
+    minus = select(equ, V(0.0f), select(center <= neighbour, max_mask, center - neighbour));
+    plus = select(equ, V(0.0f), select(neighbour <= center, max_mask, neighbour - center));
+}
+
+// ------------
+
+// VCL2 vectors for the modes in rg_modes.h, members are qualified since they shadow the VCL2 functions
+template<typename V>
+struct rg_ops<V, std::enable_if_t<!std::is_arithmetic_v<V>>> {
+    static RG_FORCEINLINE V min(const V& a, const V& b) { return VCL_NAMESPACE::min(a, b); }
+    static RG_FORCEINLINE V max(const V& a, const V& b) { return VCL_NAMESPACE::max(a, b); }
+    static RG_FORCEINLINE V clip(const V& val, const V& minimum, const V& maximum) { return simd_clip(val, minimum, maximum); }
+    static RG_FORCEINLINE V abs_diff(const V& a, const V& b) { return simd_abs_diff(a, b); }
+    static RG_FORCEINLINE V avg(const V& a, const V& b) { return simd_avg(a, b); }
+
+    template<typename M>
+    static RG_FORCEINLINE V select(const M& mask, const V& a, const V& b) { return VCL_NAMESPACE::select(mask, a, b); }
+};
+
+// vector kernel of a mode from rg_modes.h, the counterpart of rg_cpp
+template<typename V, typename mode, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_simd(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    return mode::apply(a1, a2, a3, a4, c, a5, a6, a7, a8);
+}
+
+// ------------
+
+// Batcher odd-even merge sort of a1..a8, unused ranks are optimized away
+template<typename V>
+static RG_FORCEINLINE void sort_pair_simd(V& a, V& b) {
+    auto t = min(a, b);
+    b = max(a, b);
+    a = t;
+}
+
+template<typename V>
+static RG_FORCEINLINE void sort8_simd(V& a1, V& a2, V& a3, V& a4, V& a5, V& a6, V& a7, V& a8) {
+    sort_pair_simd(a1, a2); sort_pair_simd(a3, a4); sort_pair_simd(a5, a6); sort_pair_simd(a7, a8);
+    sort_pair_simd(a1, a3); sort_pair_simd(a2, a4); sort_pair_simd(a5, a7); sort_pair_simd(a6, a8);
+    sort_pair_simd(a2, a3); sort_pair_simd(a6, a7);
+    sort_pair_simd(a1, a5); sort_pair_simd(a2, a6); sort_pair_simd(a3, a7); sort_pair_simd(a4, a8);
+    sort_pair_simd(a3, a5); sort_pair_simd(a4, a6);
+    sort_pair_simd(a2, a3); sort_pair_simd(a4, a5); sort_pair_simd(a6, a7);
+}
+
+// modes 2-4, see rg_rank_cpp: the center is clipped between the rank-th smallest and the rank-th largest neighbour.
+// Vectors cannot share column sorts between neighbouring pixels, so the full network is used,
+// the compiler drops the comparators that do not lead to the two outputs.
+template<typename V, int rank, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_rank_simd(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    sort8_simd(a1, a2, a3, a4, a5, a6, a7, a8);
+    const V sorted[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
+
+    return simd_clip(c, sorted[rank - 1], sorted[8 - rank]);
+}
+
+// ------------
+
+template<typename V>
+static RG_FORCEINLINE V rg_mode6_simd(const uint8_t* pSrc, ptrdiff_t srcPitch, const V& pixel_max) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    auto mal1 = max(a1, a8);
+    auto mil1 = min(a1, a8);
+
+    auto mal2 = max(a2, a7);
+    auto mil2 = min(a2, a7);
+
+    auto mal3 = max(a3, a6);
+    auto mil3 = min(a3, a6);
+
+    auto mal4 = max(a4, a5);
+    auto mil4 = min(a4, a5);
+
+    auto d1 = sub_saturated(mal1, mil1);
+    auto d2 = sub_saturated(mal2, mil2);
+    auto d3 = sub_saturated(mal3, mil3);
+    auto d4 = sub_saturated(mal4, mil4);
+
+    auto clipped1 = simd_clip(c, mil1, mal1);
+    auto clipped2 = simd_clip(c, mil2, mal2);
+    auto clipped3 = simd_clip(c, mil3, mal3);
+    auto clipped4 = simd_clip(c, mil4, mal4);
+
+    auto absdiff1 = simd_abs_diff(c, clipped1);
+    auto absdiff2 = simd_abs_diff(c, clipped2);
+    auto absdiff3 = simd_abs_diff(c, clipped3);
+    auto absdiff4 = simd_abs_diff(c, clipped4);
+
+    // (absdiff << 1) can leave the pixel range, saturate it before adding
+    auto c1 = simd_adds(simd_adds(absdiff1, absdiff1, pixel_max), d1, pixel_max);
+    auto c2 = simd_adds(simd_adds(absdiff2, absdiff2, pixel_max), d2, pixel_max);
+    auto c3 = simd_adds(simd_adds(absdiff3, absdiff3, pixel_max), d3, pixel_max);
+    auto c4 = simd_adds(simd_adds(absdiff4, absdiff4, pixel_max), d4, pixel_max);
+
+    auto mindiff = min(min(min(c1, c2), c3), c4);
+
+    auto result = select(mindiff == c3, clipped3, clipped1);
+    result = select(mindiff == c2, clipped2, result);
+    return select(mindiff == c4, clipped4, result);
+}
+
+// ------------
+
+template<typename V>
+static RG_FORCEINLINE V rg_mode7_simd(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    auto mal1 = max(a1, a8);
+    auto mil1 = min(a1, a8);
+
+    auto mal2 = max(a2, a7);
+    auto mil2 = min(a2, a7);
+
+    auto mal3 = max(a3, a6);
+    auto mil3 = min(a3, a6);
+
+    auto mal4 = max(a4, a5);
+    auto mil4 = min(a4, a5);
+
+    auto d1 = sub_saturated(mal1, mil1);
+    auto d2 = sub_saturated(mal2, mil2);
+    auto d3 = sub_saturated(mal3, mil3);
+    auto d4 = sub_saturated(mal4, mil4);
+
+    auto clipped1 = simd_clip(c, mil1, mal1);
+    auto clipped2 = simd_clip(c, mil2, mal2);
+    auto clipped3 = simd_clip(c, mil3, mal3);
+    auto clipped4 = simd_clip(c, mil4, mal4);
+
+    auto c1 = add_saturated(simd_abs_diff(c, clipped1), d1);
+    auto c2 = add_saturated(simd_abs_diff(c, clipped2), d2);
+    auto c3 = add_saturated(simd_abs_diff(c, clipped3), d3);
+    auto c4 = add_saturated(simd_abs_diff(c, clipped4), d4);
+
+    auto mindiff = min(min(min(c1, c2), c3), c4);
+
+    auto result = select(mindiff == c3, clipped3, clipped1);
+    result = select(mindiff == c2, clipped2, result);
+    return select(mindiff == c4, clipped4, result);
+}
+
+// ------------
+
+template<typename V>
+static RG_FORCEINLINE V rg_mode8_simd(const uint8_t* pSrc, ptrdiff_t srcPitch, const V& pixel_max) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    auto mal1 = max(a1, a8);
+    auto mil1 = min(a1, a8);
+
+    auto mal2 = max(a2, a7);
+    auto mil2 = min(a2, a7);
+
+    auto mal3 = max(a3, a6);
+    auto mil3 = min(a3, a6);
+
+    auto mal4 = max(a4, a5);
+    auto mil4 = min(a4, a5);
+
+    auto d1 = sub_saturated(mal1, mil1);
+    auto d2 = sub_saturated(mal2, mil2);
+    auto d3 = sub_saturated(mal3, mil3);
+    auto d4 = sub_saturated(mal4, mil4);
+
+    auto clipped1 = simd_clip(c, mil1, mal1);
+    auto clipped2 = simd_clip(c, mil2, mal2);
+    auto clipped3 = simd_clip(c, mil3, mal3);
+    auto clipped4 = simd_clip(c, mil4, mal4);
+
+    auto c1 = simd_adds(simd_abs_diff(c, clipped1), simd_adds(d1, d1, pixel_max), pixel_max);
+    auto c2 = simd_adds(simd_abs_diff(c, clipped2), simd_adds(d2, d2, pixel_max), pixel_max);
+    auto c3 = simd_adds(simd_abs_diff(c, clipped3), simd_adds(d3, d3, pixel_max), pixel_max);
+    auto c4 = simd_adds(simd_abs_diff(c, clipped4), simd_adds(d4, d4, pixel_max), pixel_max);
+
+    auto mindiff = min(min(min(c1, c2), c3), c4);
+
+    auto result = select(mindiff == c3, clipped3, clipped1);
+    result = select(mindiff == c2, clipped2, result);
+    return select(mindiff == c4, clipped4, result);
+}
+
+// ------------
+
+//rounding does not match, 8 bit has no +4 like the C version
+template<typename V>
+static RG_FORCEINLINE V rg_mode15_and16_simd(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    auto d1 = simd_abs_diff(a1, a8);
+    auto d2 = simd_abs_diff(a2, a7);
+    auto d3 = simd_abs_diff(a3, a6);
+
+    auto mindiff = min(min(d1, d2), d3);
+
+    auto average = [](auto a1, auto a2, auto a3, auto a6, auto a7, auto a8) {
+        using W = decltype(a1);
+        constexpr int rounder = pixel_size == 1 ? 0 : 4;
+        return (a1 + (a2 << 1) + a3 + a6 + (a7 << 1) + a8 + W(rounder)) >> 3;
+    };
+
+    V avg = compress(
+        average(extend_low(a1), extend_low(a2), extend_low(a3), extend_low(a6), extend_low(a7), extend_low(a8)),
+        average(extend_high(a1), extend_high(a2), extend_high(a3), extend_high(a6), extend_high(a7), extend_high(a8)));
+
+    auto result = select(mindiff == d3, simd_clip(avg, min(a3, a6), max(a3, a6)), simd_clip(avg, min(a1, a8), max(a1, a8)));
+    return select(mindiff == d2, simd_clip(avg, min(a2, a7), max(a2, a7)), result);
+}
+
+// ------------
+
+template<typename V>
+static RG_FORCEINLINE V rg_mode19_simd(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    // same averaging chain as the C version, ((p - 1) + q + 1) >> 1 is a rounded down average
+    auto p = simd_avg(simd_avg(a1, a3), simd_avg(a6, a8));
+    auto q = simd_avg(simd_avg(a2, a5), simd_avg(a4, a7));
+
+    return simd_avg_down(p, q);
+}
+
+// ------------
+
+// exact=True kernels, integer vectors only. They keep the saturating - 1 of the AviSynth SSE2 versions.
+
+template<typename V>
+static RG_FORCEINLINE V rg_mode12_exact_simd(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    auto a123 = simd_avg(a2, simd_avg(a1, a3));
+    auto a678 = simd_avg(a7, simd_avg(a6, a8));
+    auto a4c5 = simd_avg(c, simd_avg(a4, a5));
+    auto a123678 = sub_saturated(simd_avg(a123, a678), V(1));
+
+    return simd_avg(a123678, a4c5);
+}
+
+template<typename V>
+static RG_FORCEINLINE V rg_mode19_exact_simd(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    auto a1368 = sub_saturated(simd_avg(simd_avg(a1, a3), simd_avg(a6, a8)), V(1));
+    auto a2457 = simd_avg(simd_avg(a2, a5), simd_avg(a4, a7));
+
+    return simd_avg(a1368, a2457);
+}
+
+// ------------
+
+//rounding does not match
+template<typename V>
+static RG_FORCEINLINE V rg_mode21_simd(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    auto l1a = simd_avg_down(a1, a8);
+    auto l2a = simd_avg_down(a2, a7);
+    auto l3a = simd_avg_down(a3, a6);
+    auto l4a = simd_avg_down(a4, a5);
+
+    auto l1b = simd_avg(a1, a8);
+    auto l2b = simd_avg(a2, a7);
+    auto l3b = simd_avg(a3, a6);
+    auto l4b = simd_avg(a4, a5);
+
+    auto ma = max(max(max(l1b, l2b), l3b), l4b);
+    auto mi = min(min(min(l1a, l2a), l3a), l4a);
+
+    return simd_clip(c, mi, ma);
+}
+
+// ------------
+
+template<typename V>
+static RG_FORCEINLINE V rg_mode23_simd(const uint8_t* pSrc, ptrdiff_t srcPitch, const V& pixel_max) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    auto mal1 = max(a1, a8);
+    auto mil1 = min(a1, a8);
+
+    auto mal2 = max(a2, a7);
+    auto mil2 = min(a2, a7);
+
+    auto mal3 = max(a3, a6);
+    auto mil3 = min(a3, a6);
+
+    auto mal4 = max(a4, a5);
+    auto mil4 = min(a4, a5);
+
+    auto linediff1 = sub_saturated(mal1, mil1);
+    auto linediff2 = sub_saturated(mal2, mil2);
+    auto linediff3 = sub_saturated(mal3, mil3);
+    auto linediff4 = sub_saturated(mal4, mil4);
+
+    auto u1 = min(sub_saturated(c, mal1), linediff1);
+    auto u2 = min(sub_saturated(c, mal2), linediff2);
+    auto u3 = min(sub_saturated(c, mal3), linediff3);
+    auto u4 = min(sub_saturated(c, mal4), linediff4);
+    auto u = max(max(max(u1, u2), u3), u4);
+
+    auto d1 = min(sub_saturated(mil1, c), linediff1);
+    auto d2 = min(sub_saturated(mil2, c), linediff2);
+    auto d3 = min(sub_saturated(mil3, c), linediff3);
+    auto d4 = min(sub_saturated(mil4, c), linediff4);
+    auto d = max(max(max(d1, d2), d3), d4);
+
+    return simd_adds(sub_saturated(c, u), d, pixel_max);
+}
+
+// ------------
+
+template<typename V>
+static RG_FORCEINLINE V rg_mode24_simd(const uint8_t* pSrc, ptrdiff_t srcPitch, const V& pixel_max) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    auto mal1 = max(a1, a8);
+    auto mil1 = min(a1, a8);
+
+    auto mal2 = max(a2, a7);
+    auto mil2 = min(a2, a7);
+
+    auto mal3 = max(a3, a6);
+    auto mil3 = min(a3, a6);
+
+    auto mal4 = max(a4, a5);
+    auto mil4 = min(a4, a5);
+
+    auto linediff1 = sub_saturated(mal1, mil1);
+    auto linediff2 = sub_saturated(mal2, mil2);
+    auto linediff3 = sub_saturated(mal3, mil3);
+    auto linediff4 = sub_saturated(mal4, mil4);
+
+    auto t1 = sub_saturated(c, mal1);
+    auto t2 = sub_saturated(c, mal2);
+    auto t3 = sub_saturated(c, mal3);
+    auto t4 = sub_saturated(c, mal4);
+
+    auto u1 = min(t1, sub_saturated(linediff1, t1));
+    auto u2 = min(t2, sub_saturated(linediff2, t2));
+    auto u3 = min(t3, sub_saturated(linediff3, t3));
+    auto u4 = min(t4, sub_saturated(linediff4, t4));
+    auto u = max(max(max(u1, u2), u3), u4);
+
+    t1 = sub_saturated(mil1, c);
+    t2 = sub_saturated(mil2, c);
+    t3 = sub_saturated(mil3, c);
+    t4 = sub_saturated(mil4, c);
+
+    auto d1 = min(t1, sub_saturated(linediff1, t1));
+    auto d2 = min(t2, sub_saturated(linediff2, t2));
+    auto d3 = min(t3, sub_saturated(linediff3, t3));
+    auto d4 = min(t4, sub_saturated(linediff4, t4));
+    auto d = max(max(max(d1, d2), d3), d4);
+
+    return simd_adds(sub_saturated(c, u), d, pixel_max);
+}
+
+// ------------
+
+template<typename V>
+static RG_FORCEINLINE V rg_mode25_simd(const uint8_t* pSrc, ptrdiff_t srcPitch, const V& pixel_max) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    V SSE4, SSE5; // global collectors, minus and plus
+    V SSE6, SSE7; // actual results
+
+    neighbourdiff_simd(SSE4, SSE5, c, a4, pixel_max);
+
+    neighbourdiff_simd(SSE6, SSE7, c, a5, pixel_max);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd(SSE6, SSE7, c, a1, pixel_max);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd(SSE6, SSE7, c, a2, pixel_max);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd(SSE6, SSE7, c, a3, pixel_max);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd(SSE6, SSE7, c, a6, pixel_max);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd(SSE6, SSE7, c, a7, pixel_max);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd(SSE6, SSE7, c, a8, pixel_max);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    return sharpen_simd(c, SSE4, SSE5, pixel_max);
+}
+
+// ------------
+
+// float versions, only for modes where the integer kernels rely on saturation or integer rounding.
+// Arithmetic is done in the same order as rg_modeN_cpp_32 to give identical results.
+
+template<typename V, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_mode6_simd_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    auto mal1 = max(a1, a8);
+    auto mil1 = min(a1, a8);
+
+    auto mal2 = max(a2, a7);
+    auto mil2 = min(a2, a7);
+
+    auto mal3 = max(a3, a6);
+    auto mil3 = min(a3, a6);
+
+    auto mal4 = max(a4, a5);
+    auto mil4 = min(a4, a5);
+
+    auto d1 = subs_simd_32_for_diff(mal1, mil1);
+    auto d2 = subs_simd_32_for_diff(mal2, mil2);
+    auto d3 = subs_simd_32_for_diff(mal3, mil3);
+    auto d4 = subs_simd_32_for_diff(mal4, mil4);
+
+    auto clipped1 = simd_clip(c, mil1, mal1);
+    auto clipped2 = simd_clip(c, mil2, mal2);
+    auto clipped3 = simd_clip(c, mil3, mal3);
+    auto clipped4 = simd_clip(c, mil4, mal4);
+
+    // adds_32_c_for_diff, doubling is exact so a fused multiply-add rounds the same way
+    auto c1 = min(mul_add(abs(c - clipped1), V(2.0f), d1), V(1.0f));
+    auto c2 = min(mul_add(abs(c - clipped2), V(2.0f), d2), V(1.0f));
+    auto c3 = min(mul_add(abs(c - clipped3), V(2.0f), d3), V(1.0f));
+    auto c4 = min(mul_add(abs(c - clipped4), V(2.0f), d4), V(1.0f));
+
+    auto mindiff = min(min(min(c1, c2), c3), c4);
+
+    auto result = select(mindiff == c3, clipped3, clipped1);
+    result = select(mindiff == c2, clipped2, result);
+    return select(mindiff == c4, clipped4, result);
+}
+
+// ------------
+
+template<typename V, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_mode7_simd_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    auto mal1 = max(a1, a8);
+    auto mil1 = min(a1, a8);
+
+    auto mal2 = max(a2, a7);
+    auto mil2 = min(a2, a7);
+
+    auto mal3 = max(a3, a6);
+    auto mil3 = min(a3, a6);
+
+    auto mal4 = max(a4, a5);
+    auto mil4 = min(a4, a5);
+
+    auto d1 = subs_simd_32_for_diff(mal1, mil1);
+    auto d2 = subs_simd_32_for_diff(mal2, mil2);
+    auto d3 = subs_simd_32_for_diff(mal3, mil3);
+    auto d4 = subs_simd_32_for_diff(mal4, mil4);
+
+    auto clipped1 = simd_clip(c, mil1, mal1);
+    auto clipped2 = simd_clip(c, mil2, mal2);
+    auto clipped3 = simd_clip(c, mil3, mal3);
+    auto clipped4 = simd_clip(c, mil4, mal4);
+
+    auto c1 = abs(c - clipped1) + d1; // no adds needed
+    auto c2 = abs(c - clipped2) + d2;
+    auto c3 = abs(c - clipped3) + d3;
+    auto c4 = abs(c - clipped4) + d4;
+
+    auto mindiff = min(min(min(c1, c2), c3), c4);
+
+    auto result = select(mindiff == c3, clipped3, clipped1);
+    result = select(mindiff == c2, clipped2, result);
+    return select(mindiff == c4, clipped4, result);
+}
+
+// ------------
+
+template<typename V, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_mode8_simd_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    auto mal1 = max(a1, a8);
+    auto mil1 = min(a1, a8);
+
+    auto mal2 = max(a2, a7);
+    auto mil2 = min(a2, a7);
+
+    auto mal3 = max(a3, a6);
+    auto mil3 = min(a3, a6);
+
+    auto mal4 = max(a4, a5);
+    auto mil4 = min(a4, a5);
+
+    auto d1 = subs_simd_32_for_diff(mal1, mil1);
+    auto d2 = subs_simd_32_for_diff(mal2, mil2);
+    auto d3 = subs_simd_32_for_diff(mal3, mil3);
+    auto d4 = subs_simd_32_for_diff(mal4, mil4);
+
+    auto clipped1 = simd_clip(c, mil1, mal1);
+    auto clipped2 = simd_clip(c, mil2, mal2);
+    auto clipped3 = simd_clip(c, mil3, mal3);
+    auto clipped4 = simd_clip(c, mil4, mal4);
+
+    auto c1 = mul_add(d1, V(2.0f), abs(c - clipped1)); // no adds needed
+    auto c2 = mul_add(d2, V(2.0f), abs(c - clipped2));
+    auto c3 = mul_add(d3, V(2.0f), abs(c - clipped3));
+    auto c4 = mul_add(d4, V(2.0f), abs(c - clipped4));
+
+    auto mindiff = min(min(min(c1, c2), c3), c4);
+
+    auto result = select(mindiff == c3, clipped3, clipped1);
+    result = select(mindiff == c2, clipped2, result);
+    return select(mindiff == c4, clipped4, result);
+}
+
+// ------------
+
+template<typename V, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_mode11_simd_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    // products by powers of two are exact, fusing them does not change the result
+    V sum = mul_add(V(4.0f), c, V(2.0f) * (a2 + a4 + a5 + a7)) + a1 + a3 + a6 + a8;
+    return sum * V(1.0f / 16.0f);
+}
+
+// ------------
+
+template<typename V, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_mode15_and16_simd_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    auto d1 = simd_abs_diff(a1, a8);
+    auto d2 = simd_abs_diff(a2, a7);
+    auto d3 = simd_abs_diff(a3, a6);
+
+    auto mindiff = min(min(d1, d2), d3);
+
+    V average = (mul_add(V(2.0f), a7, mul_add(V(2.0f), a2, a1) + a3 + a6) + a8) * V(1.0f / 8.0f);
+
+    auto result = select(mindiff == d3, simd_clip(average, min(a3, a6), max(a3, a6)), simd_clip(average, min(a1, a8), max(a1, a8)));
+    return select(mindiff == d2, simd_clip(average, min(a2, a7), max(a2, a7)), result);
+}
+
+// ------------
+
+template<typename V, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_mode19_simd_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    return (a1 + a2 + a3 + a4 + a5 + a6 + a7 + a8) * V(1.0f / 8.0f);
+}
+
+// ------------
+
+template<typename V, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_mode20_simd_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    // a true division, 1/9 is not exact
+    return (a1 + a2 + a3 + a4 + c + a5 + a6 + a7 + a8) / V(9.0f);
+}
+
+// ------------
+
+template<typename V, bool chroma, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_mode23_simd_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    auto mal1 = max(a1, a8);
+    auto mil1 = min(a1, a8);
+
+    auto mal2 = max(a2, a7);
+    auto mil2 = min(a2, a7);
+
+    auto mal3 = max(a3, a6);
+    auto mil3 = min(a3, a6);
+
+    auto mal4 = max(a4, a5);
+    auto mil4 = min(a4, a5);
+
+    auto linediff1 = subs_simd_32_for_diff(mal1, mil1);
+    auto linediff2 = subs_simd_32_for_diff(mal2, mil2);
+    auto linediff3 = subs_simd_32_for_diff(mal3, mil3);
+    auto linediff4 = subs_simd_32_for_diff(mal4, mil4);
+
+    auto u1 = min(linediff1, subs_simd_32_for_diff(c, mal1));
+    auto u2 = min(linediff2, subs_simd_32_for_diff(c, mal2));
+    auto u3 = min(linediff3, subs_simd_32_for_diff(c, mal3));
+    auto u4 = min(linediff4, subs_simd_32_for_diff(c, mal4));
+    auto u = max(max(max(u1, u2), u3), u4);
+
+    auto d1 = min(linediff1, subs_simd_32_for_diff(mil1, c));
+    auto d2 = min(linediff2, subs_simd_32_for_diff(mil2, c));
+    auto d3 = min(linediff3, subs_simd_32_for_diff(mil3, c));
+    auto d4 = min(linediff4, subs_simd_32_for_diff(mil4, c));
+    auto d = max(max(max(d1, d2), d3), d4);
+
+    return adds_simd_32<V, chroma>(subs_simd_32<V, chroma>(c, u), d);
+}
+
+// ------------
+
+template<typename V, bool chroma, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_mode24_simd_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    auto mal1 = max(a1, a8);
+    auto mil1 = min(a1, a8);
+
+    auto mal2 = max(a2, a7);
+    auto mil2 = min(a2, a7);
+
+    auto mal3 = max(a3, a6);
+    auto mil3 = min(a3, a6);
+
+    auto mal4 = max(a4, a5);
+    auto mil4 = min(a4, a5);
+
+    auto linediff1 = subs_simd_32_for_diff(mal1, mil1);
+    auto linediff2 = subs_simd_32_for_diff(mal2, mil2);
+    auto linediff3 = subs_simd_32_for_diff(mal3, mil3);
+    auto linediff4 = subs_simd_32_for_diff(mal4, mil4);
+
+    auto t1 = subs_simd_32_for_diff(c, mal1);
+    auto t2 = subs_simd_32_for_diff(c, mal2);
+    auto t3 = subs_simd_32_for_diff(c, mal3);
+    auto t4 = subs_simd_32_for_diff(c, mal4);
+
+    auto u1 = min(subs_simd_32_for_diff(linediff1, t1), t1);
+    auto u2 = min(subs_simd_32_for_diff(linediff2, t2), t2);
+    auto u3 = min(subs_simd_32_for_diff(linediff3, t3), t3);
+    auto u4 = min(subs_simd_32_for_diff(linediff4, t4), t4);
+    auto u = max(max(max(u1, u2), u3), u4);
+
+    t1 = subs_simd_32_for_diff(mil1, c);
+    t2 = subs_simd_32_for_diff(mil2, c);
+    t3 = subs_simd_32_for_diff(mil3, c);
+    t4 = subs_simd_32_for_diff(mil4, c);
+
+    auto d1 = min(subs_simd_32_for_diff(linediff1, t1), t1);
+    auto d2 = min(subs_simd_32_for_diff(linediff2, t2), t2);
+    auto d3 = min(subs_simd_32_for_diff(linediff3, t3), t3);
+    auto d4 = min(subs_simd_32_for_diff(linediff4, t4), t4);
+    auto d = max(max(max(d1, d2), d3), d4);
+
+    return adds_simd_32<V, chroma>(subs_simd_32<V, chroma>(c, u), d);
+}
+
+// ------------
+
+template<typename V, bool chroma, typename S = simd_native<V>>
+static RG_FORCEINLINE V rg_mode25_simd_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    V SSE4, SSE5; // global collectors, minus and plus
+    V SSE6, SSE7; // actual results
+
+    neighbourdiff_simd_32(SSE4, SSE5, c, a4);
+
+    neighbourdiff_simd_32(SSE6, SSE7, c, a5);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd_32(SSE6, SSE7, c, a1);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd_32(SSE6, SSE7, c, a2);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd_32(SSE6, SSE7, c, a3);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd_32(SSE6, SSE7, c, a6);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd_32(SSE6, SSE7, c, a7);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    neighbourdiff_simd_32(SSE6, SSE7, c, a8);
+    SSE4 = min(SSE4, SSE6);
+    SSE5 = min(SSE5, SSE7);
+
+    return sharpen_simd_32<V, chroma>(c, SSE4, SSE5);
+}
+
+// ------------
+
+// Custom: vector counterpart of custom_eval_c, regs holds the broadcast constants
+template<typename V, typename pixel_t>
+static RG_FORCEINLINE V custom_eval_simd(const uint8_t* pSrc, ptrdiff_t srcPitch, V* regs, const CustomProgram& program, const V& pixel_max) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    regs[0] = a1; regs[1] = a2; regs[2] = a3;
+    regs[3] = a4; regs[4] = c;  regs[5] = a5;
+    regs[6] = a6; regs[7] = a7; regs[8] = a8;
+
+    for (int i = 0; i < program.num_instructions; ++i) {
+        const CustomInstr& instr = program.code[i];
+        const V& x = regs[instr.src[0]];
+        const V& y = regs[instr.src[1]];
+        V result;
+        switch (instr.op) {
+        case CustomOp::min: result = min(x, y); break;
+        case CustomOp::max: result = max(x, y); break;
+        case CustomOp::clip: result = simd_clip(x, y, regs[instr.src[2]]); break;
+        case CustomOp::avg: result = simd_avg(x, y); break;
+        case CustomOp::absdiff: result = simd_abs_diff(x, y); break;
+        case CustomOp::adds:
+            if constexpr (std::is_floating_point_v<pixel_t>) result = x + y;
+            else result = simd_adds(x, y, pixel_max);
+            break;
+        default:
+            if constexpr (std::is_floating_point_v<pixel_t>) result = x - y;
+            else result = sub_saturated(x, y);
+        }
+        regs[instr.dst] = result;
+    }
+
+    return regs[program.result];
+}
+
+// ------------
+
+// MinBlur, see minblur_cpp: the mode 11 blur and the mode 4 network of rg_rank_simd on one load of the square
+
+// mode 11 sum of integer pixels in the widened lanes W
+template<typename W>
+static RG_FORCEINLINE W minblur_blur_simd(const W& a1, const W& a2, const W& a3, const W& a4, const W& c, const W& a5, const W& a6, const W& a7, const W& a8) {
+    return (((a2 + a4 + a5 + a7) << 1) + (c << 2) + a1 + a3 + a6 + a8 + W(8)) >> 4;
+}
+
+template<typename V>
+static RG_FORCEINLINE V minblur_simd(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD(V, pSrc, srcPitch);
+
+    const V blur = compress(
+        minblur_blur_simd(extend_low(a1), extend_low(a2), extend_low(a3), extend_low(a4), extend_low(c), extend_low(a5), extend_low(a6), extend_low(a7), extend_low(a8)),
+        minblur_blur_simd(extend_high(a1), extend_high(a2), extend_high(a3), extend_high(a4), extend_high(c), extend_high(a5), extend_high(a6), extend_high(a7), extend_high(a8)));
+
+    sort8_simd(a1, a2, a3, a4, a5, a6, a7, a8);
+    const V median = simd_clip(c, a4, a5);
+
+    return simd_clip(c, min(blur, median), max(blur, median));
+}
+
+// float and fp16, the blur in the order of rg_mode11_simd_32
+template<typename V, typename S = simd_native<V>>
+static RG_FORCEINLINE V minblur_simd_32(const uint8_t* pSrc, ptrdiff_t srcPitch) {
+    LOAD_SQUARE_SIMD_S(V, S, pSrc, srcPitch);
+
+    const V blur = (mul_add(V(4.0f), c, V(2.0f) * (a2 + a4 + a5 + a7)) + a1 + a3 + a6 + a8) * V(1.0f / 16.0f);
+
+    sort8_simd(a1, a2, a3, a4, a5, a6, a7, a8);
+    const V median = simd_clip(c, a4, a5);
+
+    return simd_clip(c, min(blur, median), max(blur, median));
+}
+
+#undef LOAD_SQUARE_SIMD
+#undef LOAD_SQUARE_SIMD_S
+
+// ------------
+
+// One row of a plane: the first and last pixel are copied, the rest is done in vectors.
+// The last vector is aligned to the right edge and may overlap the previous one,
+// rows narrower than a vector use the C processor.
+// With AVX-512 narrow rows are staged with masked loads instead and still run as one vector.
+// aligned: see rows_aligned_simd. One vector at x = 1, then vectors on the alignment of the row,
+// so the stores and the loads of the center row never cross a cache line.
+// stream: the aligned vectors are written with non-temporal stores, the caller ends the plane with an sfence.
+// S: pixel storage, see simd_native.
+template<typename V, typename pixel_t, auto processor, auto c_processor, bool aligned = false, bool stream = false, typename S = simd_native<V>>
+static RG_FORCEINLINE void process_row_simd(const pixel_t* pSrc, pixel_t* pDst, int width, ptrdiff_t srcPitch, int pixel_max) {
+    constexpr int pixels = V::size();
+    const V pixel_max_v(pixel_max);
+
+    pDst[0] = pSrc[0];
+    if constexpr (aligned) {
+        S::store(call_processor<processor>((const uint8_t*)(pSrc + 1), srcPitch, pixel_max_v), pDst + 1);
+        for (int x = pixels; x < width - pixels; x += pixels) {
+            if constexpr (stream)
+                S::store_nt(call_processor<processor>((const uint8_t*)(pSrc + x), srcPitch, pixel_max_v), pDst + x);
+            else
+                S::store_a(call_processor<processor>((const uint8_t*)(pSrc + x), srcPitch, pixel_max_v), pDst + x);
+        }
+        S::store(call_processor<processor>((const uint8_t*)(pSrc + width - 1 - pixels), srcPitch, pixel_max_v), pDst + width - 1 - pixels);
+    }
+    else if (width - 2 >= pixels) {
+        for (int x = 1; x < width - 1 - pixels; x += pixels)
+            S::store(call_processor<processor>((const uint8_t*)(pSrc + x), srcPitch, pixel_max_v), pDst + x);
+        S::store(call_processor<processor>((const uint8_t*)(pSrc + width - 1 - pixels), srcPitch, pixel_max_v), pDst + width - 1 - pixels);
+    }
+#if INSTRSET >= 10
+    else if (width > 2) {
+        // width - 1 <= pixels here, each staged row gets pixels [0, width) and zeros up to 2 * pixels
+        alignas(64) pixel_t rows[3][2 * pixels];
+        const pixel_t* src = reinterpret_cast<const pixel_t*>(reinterpret_cast<const uint8_t*>(pSrc) - srcPitch);
+        for (int r = 0; r < 3; ++r) {
+            S::store_a(V(0), rows[r] + pixels);
+            S::store_a(S::load_partial(width - 1, src), rows[r]);
+            S::store_partial(width - 1, S::load_partial(width - 1, src + 1), rows[r] + 1);
+            src = reinterpret_cast<const pixel_t*>(reinterpret_cast<const uint8_t*>(src) + srcPitch);
+        }
+        S::store_partial(width - 2, call_processor<processor>((const uint8_t*)(rows[1] + 1), sizeof(rows[0]), pixel_max_v), pDst + 1);
+    }
+#else
+    else {
+        for (int x = 1; x < width - 1; x += 1)
+            pDst[x] = call_processor<c_processor>((const uint8_t*)(pSrc + x), srcPitch, pixel_max);
+    }
+#endif
+    pDst[width - 1] = pSrc[width - 1];
+}
+
+// Rows the aligned kernels can take: vector aligned pointers and pitches, and a width that is a multiple
+// of the vector, so the aligned vectors end right before the last one. The tables are picked at create time
+// from the clip format, pointers and pitches are only known per frame, anything else takes the generic path.
+template<typename V>
+static RG_FORCEINLINE bool rows_aligned_simd(const uint8_t* pSrc, const uint8_t* pDst, int width, ptrdiff_t srcPitch, ptrdiff_t dstPitch) {
+    constexpr uintptr_t mask = sizeof(V) - 1;
+    const uintptr_t bits = reinterpret_cast<uintptr_t>(pSrc) | reinterpret_cast<uintptr_t>(pDst) | static_cast<uintptr_t>(srcPitch) | static_cast<uintptr_t>(dstPitch);
+    return !(bits & mask) && width % V::size() == 0 && width >= 2 * V::size();
+}
+
+template<typename V, typename pixel_t, auto processor, auto c_processor, bool aligned = false, bool stream = false, typename S = simd_native<V>>
+static void process_plane_simd(const uint8_t* pSrc8, uint8_t* pDst8, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max) {
+    if constexpr (aligned) {
+        if (!rows_aligned_simd<V>(pSrc8, pDst8, width, srcPitch, dstPitch)) {
+            process_plane_simd<V, pixel_t, processor, c_processor, false, false, S>(pSrc8, pDst8, width, height, srcPitch, dstPitch, pixel_max);
+            return;
+        }
+    }
+
+    vsh::bitblt(pDst8, dstPitch, pSrc8, srcPitch, width * sizeof(pixel_t), 1);
+
+    pixel_t* pDst = reinterpret_cast<pixel_t*>(pDst8);
+    const pixel_t* pSrc = reinterpret_cast<const pixel_t*>(pSrc8);
+
+    dstPitch /= sizeof(pixel_t);
+    const ptrdiff_t srcPitchOrig = srcPitch;
+    srcPitch /= sizeof(pixel_t);
+
+    pSrc += srcPitch;
+    pDst += dstPitch;
+    for (int y = 1; y < height - 1; ++y) {
+        process_row_simd<V, pixel_t, processor, c_processor, aligned, stream, S>(pSrc, pDst, width, srcPitchOrig, pixel_max);
+
+        pSrc += srcPitch;
+        pDst += dstPitch;
+    }
+
+    vsh::bitblt((uint8_t*)pDst, dstPitch * sizeof(pixel_t), (uint8_t*)pSrc, srcPitch * sizeof(pixel_t), width * sizeof(pixel_t), 1);
+
+    if constexpr (stream)
+        _mm_sfence();
+}
+
+template<typename V, typename pixel_t, auto processor, auto c_processor, bool aligned, bool stream, typename S>
+static void process_halfplane_simd(const uint8_t* pSrc8, uint8_t* pDst8, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max) {
+    pixel_t* pDst = reinterpret_cast<pixel_t*>(pDst8);
+    const pixel_t* pSrc = reinterpret_cast<const pixel_t*>(pSrc8);
+
+    dstPitch /= sizeof(pixel_t);
+    const ptrdiff_t srcPitchOrig = srcPitch;
+    srcPitch /= sizeof(pixel_t);
+
+    pSrc += srcPitch;
+    pDst += dstPitch;
+    for (int y = 1; y < height / 2; ++y) {
+        process_row_simd<V, pixel_t, processor, c_processor, aligned, stream, S>(pSrc, pDst, width, srcPitchOrig, pixel_max);
+        pDst[0] = S::average(pSrc[srcPitch], pSrc[-srcPitch]);
+        pDst[width - 1] = S::average(pSrc[width - 1 + srcPitch], pSrc[width - 1 - srcPitch]);
+        pSrc += srcPitch;
+        pDst += dstPitch;
+
+        vsh::bitblt((uint8_t*)pDst, dstPitch * sizeof(pixel_t), (uint8_t*)pSrc, srcPitch * sizeof(pixel_t), width * sizeof(pixel_t), 1); //other field
+
+        pSrc += srcPitch;
+        pDst += dstPitch;
+    }
+}
+
+template<typename V, typename pixel_t, auto processor, auto c_processor, bool aligned = false, bool stream = false, typename S = simd_native<V>>
+static void process_even_rows_simd(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max) {
+    if constexpr (aligned) {
+        if (!rows_aligned_simd<V>(pSrc, pDst, width, srcPitch, dstPitch)) {
+            process_even_rows_simd<V, pixel_t, processor, c_processor, false, false, S>(pSrc, pDst, width, height, srcPitch, dstPitch, pixel_max);
+            return;
+        }
+    }
+
+    vsh::bitblt(pDst, dstPitch, pSrc, srcPitch, width * sizeof(pixel_t), 2); //copy first two lines
+
+    process_halfplane_simd<V, pixel_t, processor, c_processor, aligned, stream, S>(pSrc + srcPitch, pDst + dstPitch, width, height, srcPitch, dstPitch, pixel_max);
+
+    if constexpr (stream)
+        _mm_sfence();
+}
+
+template<typename V, typename pixel_t, auto processor, auto c_processor, bool aligned = false, bool stream = false, typename S = simd_native<V>>
+static void process_odd_rows_simd(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int pixel_max) {
+    if constexpr (aligned) {
+        if (!rows_aligned_simd<V>(pSrc, pDst, width, srcPitch, dstPitch)) {
+            process_odd_rows_simd<V, pixel_t, processor, c_processor, false, false, S>(pSrc, pDst, width, height, srcPitch, dstPitch, pixel_max);
+            return;
+        }
+    }
+
+    vsh::bitblt(pDst, dstPitch, pSrc, srcPitch, width * sizeof(pixel_t), 1); //top border
+
+    process_halfplane_simd<V, pixel_t, processor, c_processor, aligned, stream, S>(pSrc, pDst, width, height, srcPitch, dstPitch, pixel_max);
+
+    vsh::bitblt(pDst + dstPitch * (height - 1), dstPitch, pSrc + srcPitch * (height - 1), srcPitch, width * sizeof(pixel_t), 1); //bottom border
+
+    if constexpr (stream)
+        _mm_sfence();
+}
+
+// ------------
+
+// Custom: same row layout as process_row_simd, rows narrower than a vector run the C program
+template<typename V, typename pixel_t>
+static void process_plane_custom_simd(const uint8_t* pSrc8, uint8_t* pDst8, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, const CustomProgram& program) {
+    constexpr int pixels = V::size();
+    V regs[CustomProgram::max_registers];
+    custom_reg_t<pixel_t> regs_c[CustomProgram::max_registers];
+    for (int i = 0; i < program.num_constants; ++i)
+        regs[CustomProgram::square_registers + i] = V(static_cast<pixel_t>(program.constants[i]));
+    custom_load_constants_c<pixel_t>(regs_c, program);
+    const V pixel_max(static_cast<pixel_t>(program.pixel_max));
+
+    vsh::bitblt(pDst8, dstPitch, pSrc8, srcPitch, width * sizeof(pixel_t), 1);
+
+    pixel_t* pDst = reinterpret_cast<pixel_t*>(pDst8);
+    const pixel_t* pSrc = reinterpret_cast<const pixel_t*>(pSrc8);
+
+    dstPitch /= sizeof(pixel_t);
+    const ptrdiff_t srcPitchOrig = srcPitch;
+    srcPitch /= sizeof(pixel_t);
+
+    pSrc += srcPitch;
+    pDst += dstPitch;
+    for (int y = 1; y < height - 1; ++y) {
+        pDst[0] = pSrc[0];
+        if (width - 2 >= pixels) {
+            for (int x = 1; x < width - 1 - pixels; x += pixels)
+                custom_eval_simd<V, pixel_t>((const uint8_t*)(pSrc + x), srcPitchOrig, regs, program, pixel_max).store(pDst + x);
+            custom_eval_simd<V, pixel_t>((const uint8_t*)(pSrc + width - 1 - pixels), srcPitchOrig, regs, program, pixel_max).store(pDst + width - 1 - pixels);
+        }
+        else {
+            for (int x = 1; x < width - 1; x += 1)
+                pDst[x] = custom_eval_c<pixel_t>((const uint8_t*)(pSrc + x), srcPitchOrig, regs_c, program);
+        }
+        pDst[width - 1] = pSrc[width - 1];
+
+        pSrc += srcPitch;
+        pDst += dstPitch;
+    }
+
+    vsh::bitblt((uint8_t*)pDst, dstPitch * sizeof(pixel_t), (uint8_t*)pSrc, srcPitch * sizeof(pixel_t), width * sizeof(pixel_t), 1);
+}
+
+// ------------
+
+// Passes for the running-sum engine in rg_functions_c.h. Columns are done in vectors with the last one
+// aligned to the right edge, rows narrower than a vector use the C passes.
+
+// separable RemoveGrain modes, sums are kept in the widened type W of the pixel vector, float in V itself
+template<int mode, typename pixel_t, typename W>
+static RG_FORCEINLINE W sep_taps_simd(const W& a, const W& b, const W& c) {
+    if constexpr (mode == 20)
+        return a + b + c;
+    else if constexpr (std::is_floating_point_v<pixel_t>)
+        return a + (b + b) + c;
+    else
+        return a + (b << 1) + c;
+}
+
+template<int mode, typename pixel_t, typename W>
+static RG_FORCEINLINE W sep_round_simd(const W& sum) {
+    if constexpr (std::is_floating_point_v<pixel_t>)
+        return mode == 20 ? sum / W(9.0f) : sum / W(16.0f);
+    else if constexpr (mode == 20)
+        return (sum + W(4)) / const_uint(9);
+    else
+        return (sum + W(8)) >> 4;
+}
+
+template<typename V, typename pixel_t, typename acc_t, int mode>
+static void sep_horizontal_simd(const pixel_t* pSrc, acc_t* pSum, int width, const ConvParams& params) {
+    constexpr int pixels = V::size();
+
+    if (width - 2 < pixels) {
+        sep_horizontal_c<pixel_t, acc_t, mode>(pSrc, pSum, width, params);
+        return;
+    }
+
+    auto columns = [&](int x) {
+        const V l = V().load(pSrc + x - 1);
+        const V c = V().load(pSrc + x);
+        const V r = V().load(pSrc + x + 1);
+        if constexpr (std::is_floating_point_v<pixel_t>) {
+            sep_taps_simd<mode, pixel_t>(l, c, r).store(pSum + x);
+        }
+        else {
+            sep_taps_simd<mode, pixel_t>(extend_low(l), extend_low(c), extend_low(r)).store(pSum + x);
+            sep_taps_simd<mode, pixel_t>(extend_high(l), extend_high(c), extend_high(r)).store(pSum + x + pixels / 2);
+        }
+    };
+
+    for (int x = 1; x < width - 1 - pixels; x += pixels)
+        columns(x);
+    columns(width - 1 - pixels);
+}
+
+template<typename V, typename pixel_t, typename acc_t, int mode>
+static void sep_vertical_simd(const acc_t* pAbove, const acc_t* pSum, const acc_t* pBelow, pixel_t* pDst, int width, const ConvParams& params) {
+    constexpr int pixels = V::size();
+
+    if (width - 2 < pixels) {
+        sep_vertical_c<pixel_t, acc_t, mode>(pAbove, pSum, pBelow, pDst, width, params);
+        return;
+    }
+
+    auto columns = [&](int x) {
+        if constexpr (std::is_floating_point_v<pixel_t>) {
+            sep_round_simd<mode, pixel_t>(sep_taps_simd<mode, pixel_t>(V().load(pAbove + x), V().load(pSum + x), V().load(pBelow + x))).store(pDst + x);
+        }
+        else {
+            using W = decltype(extend_low(V()));
+            auto half = [&](int x) {
+                return sep_round_simd<mode, pixel_t>(sep_taps_simd<mode, pixel_t>(W().load(pAbove + x), W().load(pSum + x), W().load(pBelow + x)));
+            };
+            compress(half(x), half(x + pixels / 2)).store(pDst + x);
+        }
+    };
+
+    for (int x = 1; x < width - 1 - pixels; x += pixels)
+        columns(x);
+    columns(width - 1 - pixels);
+}
+
+// 8 bit sums fit in 16 bits: at most 16 * 255 + 8
+template<typename V, typename pixel_t, int mode>
+static void process_plane_sep_simd(const uint8_t* pSrc, uint8_t* pDst, int width, int height, ptrdiff_t srcPitch, ptrdiff_t dstPitch, int) {
+    using acc_t = typename std::conditional<std::is_floating_point_v<pixel_t>, float,
+        typename std::conditional<sizeof(pixel_t) == 1, uint16_t, uint32_t>::type>::type;
+    process_plane_conv<pixel_t, acc_t, sep_horizontal_simd<V, pixel_t, acc_t, mode>, sep_vertical_simd<V, pixel_t, acc_t, mode>>(
+        pSrc, pDst, width, height, srcPitch, dstPitch, ConvParams());
+}
+
+// Convolution3x3, pixels are converted to the float vector F, V::size() / F::size() of them per pixel vector
+
+template<typename F, typename V>
+static RG_FORCEINLINE void to_float_lanes(const V& v, F* lanes) {
+    if constexpr (sizeof(V) / V::size() == 4) {
+        if constexpr (std::is_same<V, F>::value)
+            lanes[0] = v;
+        else
+            lanes[0] = to_float(decltype(truncatei(F()))(v));
+    }
+    else {
+        to_float_lanes(extend_low(v), lanes);
+        to_float_lanes(extend_high(v), lanes + V::size() / F::size() / 2);
+    }
+}
+
+// integer formats are clamped to [0, pixel_max] and rounded, U is the unsigned 32 bit vector
+template<typename U, typename F>
+static RG_FORCEINLINE U round_to_pixel(const F& val, const F& pixel_max) {
+    return U(truncatei(min(pixel_max, max(F(0.0f), val)) + F(0.5f)));
+}
+
+template<typename V, typename F>
+static RG_FORCEINLINE V from_float_lanes(const F* lanes, const F& pixel_max) {
+    if constexpr (std::is_same<V, F>::value) {
+        return lanes[0];
+    }
+    else if constexpr (sizeof(V) / V::size() == 2) {
+        using U = decltype(extend_low(V()));
+        return compress(round_to_pixel<U>(lanes[0], pixel_max), round_to_pixel<U>(lanes[1], pixel_max));
+    }
+    else {
+        using U = decltype(extend_low(extend_low(V())));
+        return compress(
+            compress(round_to_pixel<U>(lanes[0], pixel_max), round_to_pixel<U>(lanes[1], pixel_max)),
+            compress(round_to_pixel<U>(lanes[2], pixel_max), round_to_pixel<U>(lanes[3], pixel_max)));
+    }
+}
+
+template<typename V, typename F, typename pixel_t>
+static void conv_horizontal_simd(const pixel_t* pSrc, float* pSum, int width, const ConvParams& params) {
+    constexpr int pixels = V::size();
+    constexpr int lanes = pixels / F::size();
+
+    if (width - 2 < pixels) {
+        conv_horizontal_c<pixel_t>(pSrc, pSum, width, params);
+        return;
+    }
+
+    F w[3][3];
+    for (int t = 0; t < params.terms; ++t)
+        for (int i = 0; i < 3; ++i)
+            w[t][i] = F(params.horizontal[t][i]);
+
+    auto columns = [&](int x) {
+        F l[lanes], c[lanes], r[lanes];
+        to_float_lanes(V().load(pSrc + x - 1), l);
+        to_float_lanes(V().load(pSrc + x), c);
+        to_float_lanes(V().load(pSrc + x + 1), r);
+
+        float* pTerm = pSum + x;
+        for (int t = 0; t < params.terms; ++t) {
+            for (int i = 0; i < lanes; ++i)
+                (w[t][0] * l[i] + w[t][1] * c[i] + w[t][2] * r[i]).store(pTerm + i * F::size());
+            pTerm += width;
+        }
+    };
+
+    for (int x = 1; x < width - 1 - pixels; x += pixels)
+        columns(x);
+    columns(width - 1 - pixels);
+}
+
+template<typename V, typename F, typename pixel_t>
+static void conv_vertical_simd(const float* pAbove, const float* pSum, const float* pBelow, pixel_t* pDst, int width, const ConvParams& params) {
+    constexpr int pixels = V::size();
+    constexpr int lanes = pixels / F::size();
+
+    if (width - 2 < pixels) {
+        conv_vertical_c<pixel_t>(pAbove, pSum, pBelow, pDst, width, params);
+        return;
+    }
+
+    F v[3][3];
+    for (int t = 0; t < params.terms; ++t)
+        for (int i = 0; i < 3; ++i)
+            v[t][i] = F(params.vertical[t][i]);
+    const F divisor(params.divisor);
+    const F pixel_max(params.pixel_max);
+
+    auto columns = [&](int x) {
+        F sums[lanes];
+        for (int i = 0; i < lanes; ++i) {
+            const int xi = x + i * F::size();
+            F sum = v[0][0] * F().load(pAbove + xi) + v[0][1] * F().load(pSum + xi) + v[0][2] * F().load(pBelow + xi);
+            for (int t = 1; t < params.terms; ++t) {
+                const ptrdiff_t ti = static_cast<ptrdiff_t>(t) * width + xi;
+                sum += v[t][0] * F().load(pAbove + ti) + v[t][1] * F().load(pSum + ti) + v[t][2] * F().load(pBelow + ti);
+            }
+            sums[i] = sum / divisor;
+        }
+        from_float_lanes<V>(sums, pixel_max).store(pDst + x);
+    };
+
+    for (int x = 1; x < width - 1 - pixels; x += pixels)
+        columns(x);
+    columns(width - 1 - pixels);
+}
+
+// ------------
+
+// Tables in the same layout as the C ones in RemoveGrain.cpp, instantiated by each instruction set file.
+
+template<typename V, bool aligned, bool stream>
+static PlaneProcessor* simd_functions_8[] = {
+    copyPlane<uint8_t>,
+    process_plane_simd<V, uint8_t, rg_simd<V, rg_mode1>, rg_cpp<uint8_t, rg_mode1>, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_rank_simd<V, 2>, rg_mode2_cpp, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_rank_simd<V, 3>, rg_mode3_cpp, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_rank_simd<V, 4>, rg_mode4_cpp, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_simd<V, rg_mode5>, rg_cpp<uint8_t, rg_mode5>, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_mode6_simd<V>, rg_mode6_cpp, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_mode7_simd<V>, rg_mode7_cpp, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_mode8_simd<V>, rg_mode8_cpp, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_simd<V, rg_mode9>, rg_cpp<uint8_t, rg_mode9>, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_simd<V, rg_mode10>, rg_cpp<uint8_t, rg_mode10>, aligned, stream>,
+    process_plane_sep_simd<V, uint8_t, 11>,
+    process_plane_sep_simd<V, uint8_t, 12>,
+    process_even_rows_simd<V, uint8_t, rg_simd<V, rg_mode13_and14>, rg_cpp<uint8_t, rg_mode13_and14>, aligned, stream>,
+    process_odd_rows_simd<V, uint8_t, rg_simd<V, rg_mode13_and14>, rg_cpp<uint8_t, rg_mode13_and14>, aligned, stream>,
+    process_even_rows_simd<V, uint8_t, rg_mode15_and16_simd<V>, rg_mode15_and16_cpp, aligned, stream>,
+    process_odd_rows_simd<V, uint8_t, rg_mode15_and16_simd<V>, rg_mode15_and16_cpp, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_simd<V, rg_mode17>, rg_cpp<uint8_t, rg_mode17>, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_simd<V, rg_mode18>, rg_cpp<uint8_t, rg_mode18>, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_mode19_simd<V>, rg_mode19_cpp, aligned, stream>,
+    process_plane_sep_simd<V, uint8_t, 20>,
+    process_plane_simd<V, uint8_t, rg_mode21_simd<V>, rg_mode21_cpp, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_simd<V, rg_mode22>, rg_cpp<uint8_t, rg_mode22>, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_mode23_simd<V>, rg_mode23_cpp, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_mode24_simd<V>, rg_mode24_cpp, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_mode25_simd<V>, rg_mode25_cpp, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_simd<V, rg_mode26>, rg_cpp<uint8_t, rg_mode26>, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_simd<V, rg_mode27>, rg_cpp<uint8_t, rg_mode27>, aligned, stream>,
+    process_plane_simd<V, uint8_t, rg_simd<V, rg_mode28>, rg_cpp<uint8_t, rg_mode28>, aligned, stream>,
+};
+
+// 9-16 bit, the saturating modes read the pixel maximum at runtime
+template<typename V, bool aligned, bool stream>
+static PlaneProcessor* simd_functions_16[] = {
+    copyPlane<uint16_t>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode1>, rg_cpp<uint16_t, rg_mode1>, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_rank_simd<V, 2>, rg_mode2_cpp_16, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_rank_simd<V, 3>, rg_mode3_cpp_16, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_rank_simd<V, 4>, rg_mode4_cpp_16, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode5>, rg_cpp<uint16_t, rg_mode5>, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_mode6_simd<V>, rg_mode6_cpp_16, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_mode7_simd<V>, rg_mode7_cpp_16, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_mode8_simd<V>, rg_mode8_cpp_16, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode9>, rg_cpp<uint16_t, rg_mode9>, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode10>, rg_cpp<uint16_t, rg_mode10>, aligned, stream>,
+    process_plane_sep_simd<V, uint16_t, 11>,
+    process_plane_sep_simd<V, uint16_t, 12>,
+    process_even_rows_simd<V, uint16_t, rg_simd<V, rg_mode13_and14>, rg_cpp<uint16_t, rg_mode13_and14>, aligned, stream>,
+    process_odd_rows_simd<V, uint16_t, rg_simd<V, rg_mode13_and14>, rg_cpp<uint16_t, rg_mode13_and14>, aligned, stream>,
+    process_even_rows_simd<V, uint16_t, rg_mode15_and16_simd<V>, rg_mode15_and16_cpp_16, aligned, stream>,
+    process_odd_rows_simd<V, uint16_t, rg_mode15_and16_simd<V>, rg_mode15_and16_cpp_16, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode17>, rg_cpp<uint16_t, rg_mode17>, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode18>, rg_cpp<uint16_t, rg_mode18>, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_mode19_simd<V>, rg_mode19_cpp_16, aligned, stream>,
+    process_plane_sep_simd<V, uint16_t, 20>,
+    process_plane_simd<V, uint16_t, rg_mode21_simd<V>, rg_mode21_cpp_16, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode22>, rg_cpp<uint16_t, rg_mode22>, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_mode23_simd<V>, rg_mode23_cpp_16, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_mode24_simd<V>, rg_mode24_cpp_16, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_mode25_simd<V>, rg_mode25_cpp_16, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode26>, rg_cpp<uint16_t, rg_mode26>, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode27>, rg_cpp<uint16_t, rg_mode27>, aligned, stream>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode28>, rg_cpp<uint16_t, rg_mode28>, aligned, stream>,
+};
+
+template<typename V, bool chroma, bool aligned, bool stream>
+static PlaneProcessor* simd_functions_32[] = {
+    copyPlane<float>,
+    process_plane_simd<V, float, rg_simd<V, rg_mode1>, rg_cpp<float, rg_mode1>, aligned, stream>,
+    process_plane_simd<V, float, rg_rank_simd<V, 2>, rg_mode2_cpp_32, aligned, stream>,
+    process_plane_simd<V, float, rg_rank_simd<V, 3>, rg_mode3_cpp_32, aligned, stream>,
+    process_plane_simd<V, float, rg_rank_simd<V, 4>, rg_mode4_cpp_32, aligned, stream>,
+    process_plane_simd<V, float, rg_simd<V, rg_mode5>, rg_cpp<float, rg_mode5>, aligned, stream>,
+    process_plane_simd<V, float, rg_mode6_simd_32<V>, rg_mode6_cpp_32, aligned, stream>,
+    process_plane_simd<V, float, rg_mode7_simd_32<V>, rg_mode7_cpp_32, aligned, stream>,
+    process_plane_simd<V, float, rg_mode8_simd_32<V>, rg_mode8_cpp_32, aligned, stream>,
+    process_plane_simd<V, float, rg_simd<V, rg_mode9>, rg_cpp<float, rg_mode9>, aligned, stream>,
+    process_plane_simd<V, float, rg_simd<V, rg_mode10>, rg_cpp<float, rg_mode10>, aligned, stream>,
+    process_plane_sep_simd<V, float, 11>,
+    process_plane_sep_simd<V, float, 12>,
+    process_even_rows_simd<V, float, rg_simd<V, rg_mode13_and14>, rg_cpp<float, rg_mode13_and14>, aligned, stream>,
+    process_odd_rows_simd<V, float, rg_simd<V, rg_mode13_and14>, rg_cpp<float, rg_mode13_and14>, aligned, stream>,
+    process_even_rows_simd<V, float, rg_mode15_and16_simd_32<V>, rg_mode15_and16_cpp_32, aligned, stream>,
+    process_odd_rows_simd<V, float, rg_mode15_and16_simd_32<V>, rg_mode15_and16_cpp_32, aligned, stream>,
+    process_plane_simd<V, float, rg_simd<V, rg_mode17>, rg_cpp<float, rg_mode17>, aligned, stream>,
+    process_plane_simd<V, float, rg_simd<V, rg_mode18>, rg_cpp<float, rg_mode18>, aligned, stream>,
+    process_plane_simd<V, float, rg_mode19_simd_32<V>, rg_mode19_cpp_32, aligned, stream>,
+    process_plane_sep_simd<V, float, 20>,
+    process_plane_simd<V, float, rg_simd<V, rg_mode22>, rg_mode21_cpp_32, aligned, stream>, // float: same as 22
+    process_plane_simd<V, float, rg_simd<V, rg_mode22>, rg_cpp<float, rg_mode22>, aligned, stream>,
+    process_plane_simd<V, float, rg_mode23_simd_32<V, chroma>, rg_mode23_cpp_32<chroma>, aligned, stream>,
+    process_plane_simd<V, float, rg_mode24_simd_32<V, chroma>, rg_mode24_cpp_32<chroma>, aligned, stream>,
+    process_plane_simd<V, float, rg_mode25_simd_32<V, chroma>, rg_mode25_cpp_32<chroma>, aligned, stream>,
+    process_plane_simd<V, float, rg_simd<V, rg_mode26>, rg_cpp<float, rg_mode26>, aligned, stream>,
+    process_plane_simd<V, float, rg_simd<V, rg_mode27>, rg_cpp<float, rg_mode27>, aligned, stream>,
+    process_plane_simd<V, float, rg_simd<V, rg_mode28>, rg_cpp<float, rg_mode28>, aligned, stream>,
+};
+
+#if INSTRSET >= 8
+// fp16 clips: the float kernels with simd_half storage, H is simd_half<V>
+template<typename V, bool chroma, bool aligned, bool stream, typename H = simd_half<V>>
+static PlaneProcessor* simd_functions_half[] = {
+    copyPlane<uint16_t>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode1, H>, rg_half_cpp<rg_cpp<float, rg_mode1>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_rank_simd<V, 2, H>, rg_half_cpp<rg_mode2_cpp_32>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_rank_simd<V, 3, H>, rg_half_cpp<rg_mode3_cpp_32>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_rank_simd<V, 4, H>, rg_half_cpp<rg_mode4_cpp_32>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode5, H>, rg_half_cpp<rg_cpp<float, rg_mode5>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_mode6_simd_32<V, H>, rg_half_cpp<rg_mode6_cpp_32>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_mode7_simd_32<V, H>, rg_half_cpp<rg_mode7_cpp_32>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_mode8_simd_32<V, H>, rg_half_cpp<rg_mode8_cpp_32>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode9, H>, rg_half_cpp<rg_cpp<float, rg_mode9>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode10, H>, rg_half_cpp<rg_cpp<float, rg_mode10>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_mode11_simd_32<V, H>, rg_half_cpp<rg_mode11_cpp_32>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_mode11_simd_32<V, H>, rg_half_cpp<rg_mode12_cpp_32>, aligned, stream, H>,
+    process_even_rows_simd<V, uint16_t, rg_simd<V, rg_mode13_and14, H>, rg_half_cpp<rg_cpp<float, rg_mode13_and14>>, aligned, stream, H>,
+    process_odd_rows_simd<V, uint16_t, rg_simd<V, rg_mode13_and14, H>, rg_half_cpp<rg_cpp<float, rg_mode13_and14>>, aligned, stream, H>,
+    process_even_rows_simd<V, uint16_t, rg_mode15_and16_simd_32<V, H>, rg_half_cpp<rg_mode15_and16_cpp_32>, aligned, stream, H>,
+    process_odd_rows_simd<V, uint16_t, rg_mode15_and16_simd_32<V, H>, rg_half_cpp<rg_mode15_and16_cpp_32>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode17, H>, rg_half_cpp<rg_cpp<float, rg_mode17>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode18, H>, rg_half_cpp<rg_cpp<float, rg_mode18>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_mode19_simd_32<V, H>, rg_half_cpp<rg_mode19_cpp_32>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_mode20_simd_32<V, H>, rg_half_cpp<rg_mode20_cpp_32>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode22, H>, rg_half_cpp<rg_mode21_cpp_32>, aligned, stream, H>, // float: same as 22
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode22, H>, rg_half_cpp<rg_cpp<float, rg_mode22>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_mode23_simd_32<V, chroma, H>, rg_half_cpp<rg_mode23_cpp_32<chroma>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_mode24_simd_32<V, chroma, H>, rg_half_cpp<rg_mode24_cpp_32<chroma>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_mode25_simd_32<V, chroma, H>, rg_half_cpp<rg_mode25_cpp_32<chroma>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode26, H>, rg_half_cpp<rg_cpp<float, rg_mode26>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode27, H>, rg_half_cpp<rg_cpp<float, rg_mode27>>, aligned, stream, H>,
+    process_plane_simd<V, uint16_t, rg_simd<V, rg_mode28, H>, rg_half_cpp<rg_cpp<float, rg_mode28>>, aligned, stream, H>,
+};
+#endif
+
+
+// Table lookup shared by the instruction set files, nullptr if the format has no table there.
+template<typename V8, typename V16, typename V32, bool aligned, bool stream>
+static PlaneProcessor** simd_functions(int bits_per_pixel, bool chroma) {
+    switch (bits_per_pixel) {
+    case 8: return simd_functions_8<V8, aligned, stream>;
+    case 32: return chroma ? simd_functions_32<V32, true, aligned, stream> : simd_functions_32<V32, false, aligned, stream>;
+    }
+    if (bits_per_pixel > 8 && bits_per_pixel <= 16)
+        return simd_functions_16<V16, aligned, stream>;
+    return nullptr;
+}
+
+// streaming stores need the aligned row loops, there is no unaligned streaming table
+template<typename V8, typename V16, typename V32>
+static PlaneProcessor** simd_functions(int bits_per_pixel, bool chroma, bool aligned, bool stream) {
+    if (!aligned)
+        return simd_functions<V8, V16, V32, false, false>(bits_per_pixel, chroma);
+    return stream ? simd_functions<V8, V16, V32, true, true>(bits_per_pixel, chroma) : simd_functions<V8, V16, V32, true, false>(bits_per_pixel, chroma);
+}
+
+#if INSTRSET >= 8
+template<typename V, bool aligned, bool stream>
+static PlaneProcessor** simd_half_functions(bool chroma) {
+    return chroma ? simd_functions_half<V, true, aligned, stream> : simd_functions_half<V, false, aligned, stream>;
+}
+
+template<typename V>
+static PlaneProcessor** simd_half_functions(bool chroma, bool aligned, bool stream) {
+    if (!aligned)
+        return simd_half_functions<V, false, false>(chroma);
+    return stream ? simd_half_functions<V, true, true>(chroma) : simd_half_functions<V, true, false>(chroma);
+}
+#endif
+
+// exact=True replacement for a table entry, nullptr when the mode has no separate exact kernel
+template<typename V8, typename V16>
+static PlaneProcessor* simd_exact_function(int bits_per_pixel, int mode) {
+    if (bits_per_pixel == 8) {
+        if (mode == 12)
+            return process_plane_simd<V8, uint8_t, rg_mode12_exact_simd<V8>, rg_mode12_exact_cpp<uint8_t>>;
+        if (mode == 19)
+            return process_plane_simd<V8, uint8_t, rg_mode19_exact_simd<V8>, rg_mode19_exact_cpp<uint8_t>>;
+    }
+    else if (bits_per_pixel > 8 && bits_per_pixel <= 16) {
+        if (mode == 12)
+            return process_plane_simd<V16, uint16_t, rg_mode12_exact_simd<V16>, rg_mode12_exact_cpp<uint16_t>>;
+        if (mode == 19)
+            return process_plane_simd<V16, uint16_t, rg_mode19_exact_simd<V16>, rg_mode19_exact_cpp<uint16_t>>;
+    }
+    return nullptr;
+}
+
+// Convolution3x3 lookup shared by the instruction set files, F is the float vector of the same width.
+template<typename V8, typename V16, typename F>
+static ConvPlaneProcessor* simd_convolution(int bits_per_pixel) {
+    if (bits_per_pixel == 8)
+        return process_plane_conv<uint8_t, float, conv_horizontal_simd<V8, F, uint8_t>, conv_vertical_simd<V8, F, uint8_t>>;
+    if (bits_per_pixel > 8 && bits_per_pixel <= 16)
+        return process_plane_conv<uint16_t, float, conv_horizontal_simd<V16, F, uint16_t>, conv_vertical_simd<V16, F, uint16_t>>;
+    if (bits_per_pixel == 32)
+        return process_plane_conv<float, float, conv_horizontal_simd<F, F, float>, conv_vertical_simd<F, F, float>>;
+    return nullptr;
+}
+
+// Custom lookup shared by the instruction set files
+template<typename V8, typename V16, typename F>
+static CustomPlaneProcessor* simd_custom(int bits_per_pixel) {
+    if (bits_per_pixel == 8)
+        return process_plane_custom_simd<V8, uint8_t>;
+    if (bits_per_pixel > 8 && bits_per_pixel <= 16)
+        return process_plane_custom_simd<V16, uint16_t>;
+    if (bits_per_pixel == 32)
+        return process_plane_custom_simd<F, float>;
+    return nullptr;
+}
+
+// MinBlur lookup shared by the instruction set files. The aligned row loops check pointers
+// and pitches per frame and fall back to the generic ones themselves.
+template<typename V8, typename V16, typename F>
+static PlaneProcessor* simd_minblur(int bits_per_pixel) {
+    if (bits_per_pixel == 8)
+        return process_plane_simd<V8, uint8_t, minblur_simd<V8>, minblur_cpp<uint8_t>, true>;
+    if (bits_per_pixel > 8 && bits_per_pixel <= 16)
+        return process_plane_simd<V16, uint16_t, minblur_simd<V16>, minblur_cpp<uint16_t>, true>;
+    if (bits_per_pixel == 32)
+        return process_plane_simd<F, float, minblur_simd_32<F>, minblur_cpp<float>, true>;
+    return nullptr;
+}
+
+#if INSTRSET >= 8
+template<typename F, typename H = simd_half<F>>
+static PlaneProcessor* simd_half_minblur() {
+    return process_plane_simd<F, uint16_t, minblur_simd_32<F, H>, rg_half_cpp<minblur_cpp<float>>, true, false, H>;
+}
+#endif
+
+#endif
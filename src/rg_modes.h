@@ -0,0 +1,232 @@
+#pragma once
+
+#ifndef __RG_MODES_H__
+#define __RG_MODES_H__
+
+#include "common.h"
+
+// Single-source RemoveGrain modes.
+// A mode is written once against the 3x3 square and an ops policy O, rg_cpp in rg_functions_c.h
+// turns it into the C kernel of every pixel type and rg_simd in rg_functions_simd.h into the vector
+// kernel of every instruction set and pixel storage. Only the modes built from min, max, clip,
+// absolute differences and averages live here, the saturating and rounding ones stay per type.
+
+template<typename T, typename = void>
+struct rg_ops;
+
+// scalar pixels, integer averages round up like pavgb/pavgw, float ones do not round
+template<typename T>
+struct rg_ops<T, std::enable_if_t<std::is_arithmetic_v<T>>> {
+    static RG_FORCEINLINE T min(T a, T b) { return std::min(a, b); }
+    static RG_FORCEINLINE T max(T a, T b) { return std::max(a, b); }
+    static RG_FORCEINLINE T clip(T val, T minimum, T maximum) { return std::max(std::min(val, maximum), minimum); }
+    static RG_FORCEINLINE T abs_diff(T a, T b) { return static_cast<T>(a > b ? a - b : b - a); }
+
+    static RG_FORCEINLINE T avg(T a, T b) {
+        if constexpr (std::is_floating_point_v<T>)
+            return (a + b) / 2.0f;
+        else
+            return static_cast<T>((a + b + 1) / 2);
+    }
+
+    static RG_FORCEINLINE T select(bool mask, T a, T b) { return mask ? a : b; }
+};
+
+// Priority between equal candidates is a chain of selects, the last one applied wins.
+// The chains are written in the order of the original vector code, so the first
+// return of the original C code is the outermost select.
+
+struct rg_mode1 {
+    template<typename T, typename O = rg_ops<T>>
+    static RG_FORCEINLINE T apply(const T& a1, const T& a2, const T& a3, const T& a4, const T& c, const T& a5, const T& a6, const T& a7, const T& a8) {
+        T mi = O::min(
+            O::min(O::min(a1, a2), O::min(a3, a4)),
+            O::min(O::min(a5, a6), O::min(a7, a8))
+        );
+        T ma = O::max(
+            O::max(O::max(a1, a2), O::max(a3, a4)),
+            O::max(O::max(a5, a6), O::max(a7, a8))
+        );
+
+        return O::clip(c, mi, ma);
+    }
+};
+
+struct rg_mode5 {
+    template<typename T, typename O = rg_ops<T>>
+    static RG_FORCEINLINE T apply(const T& a1, const T& a2, const T& a3, const T& a4, const T& c, const T& a5, const T& a6, const T& a7, const T& a8) {
+        T clipped1 = O::clip(c, O::min(a1, a8), O::max(a1, a8));
+        T clipped2 = O::clip(c, O::min(a2, a7), O::max(a2, a7));
+        T clipped3 = O::clip(c, O::min(a3, a6), O::max(a3, a6));
+        T clipped4 = O::clip(c, O::min(a4, a5), O::max(a4, a5));
+
+        T c1 = O::abs_diff(c, clipped1);
+        T c2 = O::abs_diff(c, clipped2);
+        T c3 = O::abs_diff(c, clipped3);
+        T c4 = O::abs_diff(c, clipped4);
+
+        T mindiff = O::min(O::min(O::min(c1, c2), c3), c4);
+
+        T result = O::select(mindiff == c3, clipped3, clipped1);
+        result = O::select(mindiff == c2, clipped2, result);
+        return O::select(mindiff == c4, clipped4, result);
+    }
+};
+
+struct rg_mode9 {
+    template<typename T, typename O = rg_ops<T>>
+    static RG_FORCEINLINE T apply(const T& a1, const T& a2, const T& a3, const T& a4, const T& c, const T& a5, const T& a6, const T& a7, const T& a8) {
+        T mal1 = O::max(a1, a8);
+        T mil1 = O::min(a1, a8);
+
+        T mal2 = O::max(a2, a7);
+        T mil2 = O::min(a2, a7);
+
+        T mal3 = O::max(a3, a6);
+        T mil3 = O::min(a3, a6);
+
+        T mal4 = O::max(a4, a5);
+        T mil4 = O::min(a4, a5);
+
+        // mal >= mil, no saturation needed
+        T d1 = static_cast<T>(mal1 - mil1);
+        T d2 = static_cast<T>(mal2 - mil2);
+        T d3 = static_cast<T>(mal3 - mil3);
+        T d4 = static_cast<T>(mal4 - mil4);
+
+        T mindiff = O::min(O::min(O::min(d1, d2), d3), d4);
+
+        T result = O::select(mindiff == d3, O::clip(c, mil3, mal3), O::clip(c, mil1, mal1));
+        result = O::select(mindiff == d2, O::clip(c, mil2, mal2), result);
+        return O::select(mindiff == d4, O::clip(c, mil4, mal4), result);
+    }
+};
+
+struct rg_mode10 {
+    template<typename T, typename O = rg_ops<T>>
+    static RG_FORCEINLINE T apply(const T& a1, const T& a2, const T& a3, const T& a4, const T& c, const T& a5, const T& a6, const T& a7, const T& a8) {
+        T d1 = O::abs_diff(c, a1);
+        T d2 = O::abs_diff(c, a2);
+        T d3 = O::abs_diff(c, a3);
+        T d4 = O::abs_diff(c, a4);
+        T d5 = O::abs_diff(c, a5);
+        T d6 = O::abs_diff(c, a6);
+        T d7 = O::abs_diff(c, a7);
+        T d8 = O::abs_diff(c, a8);
+
+        T mindiff = O::min(O::min(O::min(O::min(O::min(O::min(O::min(d1, d2), d3), d4), d5), d6), d7), d8);
+
+        T result = O::select(mindiff == d5, a5, a4);
+        result = O::select(mindiff == d1, a1, result);
+        result = O::select(mindiff == d3, a3, result);
+        result = O::select(mindiff == d2, a2, result);
+        result = O::select(mindiff == d6, a6, result);
+        result = O::select(mindiff == d8, a8, result);
+        return O::select(mindiff == d7, a7, result);
+    }
+};
+
+struct rg_mode13_and14 {
+    template<typename T, typename O = rg_ops<T>>
+    static RG_FORCEINLINE T apply(const T& a1, const T& a2, const T& a3, const T&, const T&, const T&, const T& a6, const T& a7, const T& a8) {
+        T d1 = O::abs_diff(a1, a8);
+        T d2 = O::abs_diff(a2, a7);
+        T d3 = O::abs_diff(a3, a6);
+
+        T mindiff = O::min(O::min(d1, d2), d3);
+
+        T result = O::select(mindiff == d3, O::avg(a3, a6), O::avg(a1, a8));
+        return O::select(mindiff == d2, O::avg(a2, a7), result);
+    }
+};
+
+struct rg_mode17 {
+    template<typename T, typename O = rg_ops<T>>
+    static RG_FORCEINLINE T apply(const T& a1, const T& a2, const T& a3, const T& a4, const T& c, const T& a5, const T& a6, const T& a7, const T& a8) {
+        T lower = O::max(O::max(O::max(O::min(a1, a8), O::min(a2, a7)), O::min(a3, a6)), O::min(a4, a5));
+        T upper = O::min(O::min(O::min(O::max(a1, a8), O::max(a2, a7)), O::max(a3, a6)), O::max(a4, a5));
+
+        return O::clip(c, O::min(lower, upper), O::max(lower, upper));
+    }
+};
+
+struct rg_mode18 {
+    template<typename T, typename O = rg_ops<T>>
+    static RG_FORCEINLINE T apply(const T& a1, const T& a2, const T& a3, const T& a4, const T& c, const T& a5, const T& a6, const T& a7, const T& a8) {
+        T d1 = O::max(O::abs_diff(c, a1), O::abs_diff(c, a8));
+        T d2 = O::max(O::abs_diff(c, a2), O::abs_diff(c, a7));
+        T d3 = O::max(O::abs_diff(c, a3), O::abs_diff(c, a6));
+        T d4 = O::max(O::abs_diff(c, a4), O::abs_diff(c, a5));
+
+        T mindiff = O::min(O::min(O::min(d1, d2), d3), d4);
+
+        T result = O::select(mindiff == d3, O::clip(c, O::min(a3, a6), O::max(a3, a6)), O::clip(c, O::min(a1, a8), O::max(a1, a8)));
+        result = O::select(mindiff == d2, O::clip(c, O::min(a2, a7), O::max(a2, a7)), result);
+        return O::select(mindiff == d4, O::clip(c, O::min(a4, a5), O::max(a4, a5)), result);
+    }
+};
+
+// float 21 is this mode as well, its averages do not round
+struct rg_mode22 {
+    template<typename T, typename O = rg_ops<T>>
+    static RG_FORCEINLINE T apply(const T& a1, const T& a2, const T& a3, const T& a4, const T& c, const T& a5, const T& a6, const T& a7, const T& a8) {
+        T l1 = O::avg(a1, a8);
+        T l2 = O::avg(a2, a7);
+        T l3 = O::avg(a3, a6);
+        T l4 = O::avg(a4, a5);
+
+        T ma = O::max(O::max(O::max(l1, l2), l3), l4);
+        T mi = O::min(O::min(O::min(l1, l2), l3), l4);
+
+        return O::clip(c, mi, ma);
+    }
+};
+
+// Modes 26-28 narrow the clip range over pairs of neighbours, lower and upper are the
+// largest minimum and the smallest maximum of the pairs.
+
+template<typename O, typename T>
+static RG_FORCEINLINE void rg_narrow_pairs(T& lower, T& upper, const T& a, const T& b, const T& c, const T& d, const T& e, const T& f, const T& g, const T& h) {
+    lower = O::max(O::max(O::max(O::max(O::min(a, b), O::min(c, d)), O::min(e, f)), O::min(g, h)), lower);
+    upper = O::min(O::min(O::min(O::min(O::max(a, b), O::max(c, d)), O::max(e, f)), O::max(g, h)), upper);
+}
+
+struct rg_mode26 {
+    template<typename T, typename O = rg_ops<T>>
+    static RG_FORCEINLINE T apply(const T& a1, const T& a2, const T& a3, const T& a4, const T& c, const T& a5, const T& a6, const T& a7, const T& a8) {
+        T lower = O::max(O::max(O::max(O::min(a1, a2), O::min(a2, a3)), O::min(a3, a5)), O::min(a5, a8));
+        T upper = O::min(O::min(O::min(O::max(a1, a2), O::max(a2, a3)), O::max(a3, a5)), O::max(a5, a8));
+
+        rg_narrow_pairs<O>(lower, upper, a7, a8, a6, a7, a4, a6, a1, a4);
+
+        return O::clip(c, O::min(lower, upper), O::max(lower, upper));
+    }
+};
+
+struct rg_mode27 {
+    template<typename T, typename O = rg_ops<T>>
+    static RG_FORCEINLINE T apply(const T& a1, const T& a2, const T& a3, const T& a4, const T& c, const T& a5, const T& a6, const T& a7, const T& a8) {
+        T lower = O::max(O::max(O::max(O::min(a1, a8), O::min(a1, a2)), O::min(a7, a8)), O::min(a2, a7));
+        T upper = O::min(O::min(O::min(O::max(a1, a8), O::max(a1, a2)), O::max(a7, a8)), O::max(a2, a7));
+
+        rg_narrow_pairs<O>(lower, upper, a2, a3, a6, a7, a3, a6, a3, a5);
+        rg_narrow_pairs<O>(lower, upper, a4, a6, a4, a5, a5, a8, a1, a4);
+
+        return O::clip(c, O::min(lower, upper), O::max(lower, upper));
+    }
+};
+
+struct rg_mode28 {
+    template<typename T, typename O = rg_ops<T>>
+    static RG_FORCEINLINE T apply(const T& a1, const T& a2, const T& a3, const T& a4, const T& c, const T& a5, const T& a6, const T& a7, const T& a8) {
+        T lower = O::max(O::max(O::max(O::min(a1, a2), O::min(a2, a3)), O::min(a3, a5)), O::min(a5, a8));
+        T upper = O::min(O::min(O::min(O::max(a1, a2), O::max(a2, a3)), O::max(a3, a5)), O::max(a5, a8));
+
+        rg_narrow_pairs<O>(lower, upper, a7, a8, a6, a7, a4, a6, a1, a4);
+        rg_narrow_pairs<O>(lower, upper, a1, a8, a3, a6, a2, a7, a4, a5);
+
+        return O::clip(c, O::min(lower, upper), O::max(lower, upper));
+    }
+};
+
+#endif
@@ -2,5 +2,9 @@
 
 VS_EXTERNAL_API(void) VapourSynthPluginInit2(VSPlugin* plugin, const VSPLUGINAPI* vspapi) {
 	vspapi->configPlugin("com.julek.rgtools", "rgtools", "RgTools", VS_MAKE_VERSION(1, 0), VAPOURSYNTH_API_VERSION, 0, plugin);
-	vspapi->registerFunction("RemoveGrain", "clip:vnode;mode:int:opt;", "clip:vnode;", rgToolsCreate, nullptr, plugin);
+	vspapi->registerFunction("RemoveGrain", "clip:vnode;mode:int[]:opt;opt:int:opt;rank:int:opt;exact:int:opt;border:int:opt;stream:int:opt;threads:int:opt;", "clip:vnode;", rgToolsCreate, nullptr, plugin);
+	vspapi->registerFunction("RemoveGrainMulti", "clip:vnode;modes:int[];opt:int:opt;exact:int:opt;", "clip:vnode[];", rgToolsMultiCreate, nullptr, plugin);
+	vspapi->registerFunction("Convolution3x3", "clip:vnode;weights:int[];divisor:float:opt;opt:int:opt;", "clip:vnode;", convolution3x3Create, nullptr, plugin);
+	vspapi->registerFunction("Custom", "clip:vnode;expr:data;opt:int:opt;", "clip:vnode;", customCreate, nullptr, plugin);
+	vspapi->registerFunction("MinBlur", "clip:vnode;r:int:opt;planes:int[]:opt;opt:int:opt;", "clip:vnode;", minBlurCreate, nullptr, plugin);
 }
\ No newline at end of file